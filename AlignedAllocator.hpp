@@ -0,0 +1,45 @@
+#ifndef ALIGNEDALLOCATOR_HPP_R2XK7D
+#define ALIGNEDALLOCATOR_HPP_R2XK7D
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/// A minimal C++11 allocator that hands out storage aligned to Alignment bytes,
+/// so std::vector can back arrays that are read with aligned SIMD loads.
+template <typename T, std::size_t Alignment>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment> &) { }
+
+	T *allocate(std::size_t n)
+	{
+		void *p = nullptr;
+		if(posix_memalign(&p, Alignment, n * sizeof(T)) != 0) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T *>(p);
+	}
+
+	void deallocate(T *p, std::size_t)
+	{
+		std::free(p);
+	}
+
+	template <typename U>
+	bool operator ==(const AlignedAllocator<U, Alignment> &) const { return true; }
+
+	template <typename U>
+	bool operator !=(const AlignedAllocator<U, Alignment> &) const { return false; }
+};
+
+#endif // ALIGNEDALLOCATOR_HPP_R2XK7D
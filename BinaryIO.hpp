@@ -0,0 +1,151 @@
+/// \file
+#ifndef BINARYIO_HPP_V9FQ3E
+#define BINARYIO_HPP_V9FQ3E
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/// Raw binary reading and writing of trivially copyable values and vectors
+/// of them, in the machine's own byte order. Meant for files a build writes
+/// and reads back on the same kind of machine (checkpoints, caches), not for
+/// exchange. Reads throw std::runtime_error on a short or failed read.
+
+template <typename T>
+void writeBinary(std::ostream &out, const T &value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "writeBinary needs a trivially copyable type");
+	out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+void readBinary(std::istream &in, T &value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "readBinary needs a trivially copyable type");
+	if(!in.read(reinterpret_cast<char *>(&value), sizeof(value))) {
+		throw std::runtime_error("Unexpected end of binary file");
+	}
+}
+
+template <typename T>
+T readBinary(std::istream &in)
+{
+	T value;
+	readBinary(in, value);
+	return value;
+}
+
+/// Write the length of v followed by its elements
+template <typename T, typename A>
+void writeBinary(std::ostream &out, const std::vector<T, A> &v)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "writeBinary needs a trivially copyable type");
+	writeBinary(out, static_cast<std::uint64_t>(v.size()));
+	out.write(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+}
+
+template <typename T, typename A>
+void readBinary(std::istream &in, std::vector<T, A> &v)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "readBinary needs a trivially copyable type");
+	const auto size = readBinary<std::uint64_t>(in);
+	v.resize(size);
+	if(!in.read(reinterpret_cast<char *>(v.data()), size * sizeof(T))) {
+		throw std::runtime_error("Unexpected end of binary file");
+	}
+}
+
+/// Write a fixed tag identifying the kind and version of a file
+inline void writeMagic(std::ostream &out, const char (&magic)[9])
+{
+	out.write(magic, 8);
+}
+
+/// Read a tag written by writeMagic and throw if it isn't the expected one
+inline void expectMagic(std::istream &in, const char (&magic)[9], const std::string &what)
+{
+	char found[8];
+	if(!in.read(found, 8) || std::string(found, 8) != std::string(magic, 8)) {
+		throw std::runtime_error("Not a " + what + " (or one from an incompatible version)");
+	}
+}
+
+/// Reads what writeBinary() and writeMagic() wrote from memory, such as a
+/// MappedFile, with the same checks as the stream versions. Values are
+/// copied out with memcpy, so the buffer needn't be aligned.
+class BinaryBuffer {
+	const char *pos;
+	const char *end;
+
+	const char *take(size_t bytes)
+	{
+		if(size_t(end - pos) < bytes) {
+			throw std::runtime_error("Unexpected end of binary file");
+		}
+		const char *p = pos;
+		pos += bytes;
+		return p;
+	}
+
+public:
+	BinaryBuffer(const char *begin, const char *end)
+	: pos(begin)
+	, end(end)
+	{ }
+
+	template <typename T>
+	void read(T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "read needs a trivially copyable type");
+		std::memcpy(&value, take(sizeof(value)), sizeof(value));
+	}
+
+	template <typename T>
+	T read()
+	{
+		T value;
+		read(value);
+		return value;
+	}
+
+	template <typename T, typename A>
+	void read(std::vector<T, A> &v)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "read needs a trivially copyable type");
+		const auto size = read<std::uint64_t>();
+		if(size > (end - pos) / sizeof(T)) {
+			throw std::runtime_error("Unexpected end of binary file");
+		}
+		v.resize(size);
+		std::memcpy(v.data(), take(size * sizeof(T)), size * sizeof(T));
+	}
+
+	/// Copy count elements into out, which must have room for them
+	template <typename T>
+	void readArray(T *out, size_t count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "readArray needs a trivially copyable type");
+		if(count > (end - pos) / sizeof(T)) {
+			throw std::runtime_error("Unexpected end of binary file");
+		}
+		std::memcpy(out, take(count * sizeof(T)), count * sizeof(T));
+	}
+
+	/// Bytes not read yet
+	size_t remaining() const { return end - pos; }
+
+	void expectMagic(const char (&magic)[9], const std::string &what)
+	{
+		if(end - pos < 8 || std::string(pos, 8) != std::string(magic, 8)) {
+			throw std::runtime_error("Not a " + what + " (or one from an incompatible version)");
+		}
+		pos += 8;
+	}
+};
+
+#endif // BINARYIO_HPP_V9FQ3E
@@ -0,0 +1,66 @@
+/// \file
+#ifndef BOUNDEDQUEUE_HPP_T7LC4W
+#define BOUNDEDQUEUE_HPP_T7LC4W
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+/// A queue between two pipeline stages running on different threads.
+///
+/// push() waits while the queue holds `capacity` items, so a fast producer
+/// can't run arbitrarily far ahead of its consumer. Either side may close()
+/// the queue: the consumer then gets the items already queued and pop()
+/// returns false after them, and push() returns false from then on, so a
+/// producer notices when its consumer has given up.
+template <typename T>
+class BoundedQueue {
+public:
+	explicit BoundedQueue(std::size_t capacity)
+	: capacity(capacity)
+	{ }
+
+	/// Queue item, waiting for room. Returns false if the queue was closed.
+	bool push(T item)
+	{
+		std::unique_lock<std::mutex> lock(m);
+		notFull.wait(lock, [&] { return closed || items.size() < capacity; });
+		if(closed) return false;
+
+		items.push_back(std::move(item));
+		notEmpty.notify_one();
+		return true;
+	}
+
+	/// Take the next item, waiting for one. Returns false once the queue is
+	/// closed and empty.
+	bool pop(T &item)
+	{
+		std::unique_lock<std::mutex> lock(m);
+		notEmpty.wait(lock, [&] { return closed || !items.empty(); });
+		if(items.empty()) return false;
+
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+		return true;
+	}
+
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(m);
+		closed = true;
+		notFull.notify_all();
+		notEmpty.notify_all();
+	}
+
+private:
+	std::size_t capacity;
+	std::deque<T> items;
+	bool closed = false;
+	std::mutex m;
+	std::condition_variable notFull, notEmpty;
+};
+
+#endif // BOUNDEDQUEUE_HPP_T7LC4W
@@ -0,0 +1,78 @@
+#ifndef CAPACITYMAP_HPP_L5TB2C
+#define CAPACITYMAP_HPP_L5TB2C
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+/// Edge capacities that differ from the instance's uniform default.
+///
+/// Blockages only touch a small fraction of the grid, so rather than a dense
+/// per-edge vector this keeps a table of (edge ID, capacity) overrides.
+/// Overrides are appended while reading and sorted once by finalize(), after
+/// which lookups are a binary search. Code that needs capacities in its inner
+/// loop (such as the router's EdgeState) builds its own dense copy.
+class CapacityMap {
+public:
+	typedef std::pair<int, int> Override; ///< (edge ID, capacity)
+
+	/// Record a capacity for an edge. Later calls for the same edge win.
+	void set(int id, int capacity)
+	{
+		if(!overrides.empty() && overrides.back().first >= id) {
+			sorted = false;
+		}
+		overrides.emplace_back(id, capacity);
+		largest = std::max(largest, capacity);
+	}
+
+	/// Sort the overrides by edge ID, keeping only the last one set for each edge
+	void finalize()
+	{
+		if(sorted) return;
+
+		std::stable_sort(overrides.begin(), overrides.end(),
+		                 [](const Override &a, const Override &b) { return a.first < b.first; });
+
+		// Keep the last of each run of equal IDs
+		auto out = overrides.begin();
+		for(auto it = overrides.begin(); it != overrides.end(); ++it) {
+			if(it + 1 != overrides.end() && it[1].first == it->first) continue;
+			*out++ = *it;
+		}
+		overrides.erase(out, overrides.end());
+		sorted = true;
+	}
+
+	/// Replace every edge ID with f(ID), for when the edge numbering changes
+	template <typename F>
+	void remapIDs(const F &f)
+	{
+		for(auto &o : overrides) o.first = f(o.first);
+		sorted = false;
+		finalize();
+	}
+
+	/// Capacity of edge id, or default_ if it has no override
+	int get(int id, int default_) const
+	{
+		assert(sorted && "CapacityMap::finalize() must be called before lookups");
+		auto it = std::lower_bound(overrides.begin(), overrides.end(), id,
+		                           [](const Override &o, int i) { return o.first < i; });
+		return it != overrides.end() && it->first == id ? it->second : default_;
+	}
+
+	/// Overrides in edge ID order (once finalized)
+	const std::vector<Override> &entries() const { return overrides; }
+
+	/// Largest capacity ever set
+	int maxValue() const { return largest; }
+
+private:
+	std::vector<Override> overrides;
+	bool sorted = true;
+	int largest = 0;
+};
+
+#endif // CAPACITYMAP_HPP_L5TB2C
@@ -0,0 +1,104 @@
+/// \file
+#ifndef CONVERGENCEMONITOR_HPP_H2TV6P
+#define CONVERGENCEMONITOR_HPP_H2TV6P
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "BinaryIO.hpp"
+
+/// Tracks the progress of rip-up and reroute iteration by iteration, adapts
+/// the overflow penalty of the standard cost function to it and decides when
+/// more iterations are no longer worth their time.
+///
+/// The penalty rises while total overflow rises or stalls, by a step that
+/// doubles each time in a row that happens, and eases off by a step that
+/// halves while overflow falls or once there is none, so it settles instead
+/// of swinging by a fixed amount. It stays within [minPenalty, maxPenalty].
+///
+/// Routing has converged once the best solution of the last `window`
+/// iterations is less than `threshold` (relative) better than the best one
+/// before them. Solutions are compared by total overflow, or by wirelength
+/// once there is none.
+class ConvergenceMonitor {
+public:
+	struct Sample {
+		long long overflow;   ///< total overflow (TOF)
+		long long wirelength; ///< total wirelength
+		int violatingNets;    ///< nets using an overflowed edge
+	};
+
+	static const int minPenalty = 0;
+	static const int maxPenalty = 1000;
+	static const int maxStep = 64;
+
+	int window = 25;          ///< iterations compared to decide convergence, 0 to never stop
+	double threshold = 0.005; ///< smallest relative improvement over window worth continuing for
+
+	void record(const Sample &s)
+	{
+		samples.push_back(s);
+	}
+
+	const std::vector<Sample> &history() const { return samples; }
+
+	/// Whether a is the better solution: less overflow, then less wirelength
+	static bool better(const Sample &a, const Sample &b)
+	{
+		return a.overflow < b.overflow || (a.overflow == b.overflow && a.wirelength < b.wirelength);
+	}
+
+	/// The penalty to use for the next iteration given the current one
+	int adaptPenalty(int penalty)
+	{
+		if(samples.size() < 2) return penalty;
+
+		const Sample &now = samples.back();
+		const Sample &before = samples[samples.size() - 2];
+
+		if(now.overflow > 0 && now.overflow >= before.overflow) {
+			penalty += step;
+			step = std::min(int(maxStep), step * 2);
+		}
+		else {
+			step = std::max(1, step / 2);
+			penalty -= step;
+		}
+
+		return std::min(int(maxPenalty), std::max(int(minPenalty), penalty));
+	}
+
+	bool converged() const
+	{
+		if(window <= 0 || samples.size() <= size_t(window)) return false;
+
+		const auto split = samples.end() - window;
+		const Sample earlier = *std::min_element(samples.begin(), split, better);
+		const Sample recent = *std::min_element(split, samples.end(), better);
+
+		const bool byOverflow = earlier.overflow > 0;
+		const double was = byOverflow ? earlier.overflow : earlier.wirelength;
+		const double is = byOverflow ? recent.overflow : recent.wirelength;
+		return was - is < threshold * was;
+	}
+
+	/// Save the recorded samples and penalty step, for read() to restore
+	void write(std::ostream &out) const
+	{
+		writeBinary(out, samples);
+		writeBinary(out, step);
+	}
+
+	void read(std::istream &in)
+	{
+		readBinary(in, samples);
+		readBinary(in, step);
+	}
+
+private:
+	std::vector<Sample> samples;
+	int step = 1;
+};
+
+#endif // CONVERGENCEMONITOR_HPP_H2TV6P
@@ -0,0 +1,109 @@
+/// \file
+#ifndef COSTPOLICIES_HPP_N5WB7T
+#define COSTPOLICIES_HPP_N5WB7T
+
+#include <unordered_map>
+#include "EdgeState.hpp"
+#include "NCCostTable.hpp"
+#include "NegotiatedCongestion.hpp"
+
+/// Edge cost policies for RoutingSolver::aStarRouteSeg.
+///
+/// The maze router is a template over one of these, so each cost function
+/// gets its own inner loop with the cost computation inlined and the open
+/// list keyed by the policy's `Cost` type. A policy is a small copyable
+/// object giving
+///
+/// - `Cost`: the arithmetic type path costs are accumulated in, and
+/// - `Cost operator()(int id) const`: the cost of adding the edge with the
+///   given ID to a path, at least 1 so the L1 distance heuristic stays
+///   admissible, and
+/// - `bool usable(int id) const`: whether the search may use the edge at all.
+///
+/// Policies are also templates over the edge storage type T, reading edge
+/// state through EdgeState::Fields<T>, so the search is compiled once per
+/// storage width instead of picking the width on every edge it looks at.
+///
+/// Adding a cost model means adding a policy here and a case to the
+/// dispatch in aStarRouteSeg(Path&); the search itself is left alone.
+
+/// Utilization over capacity scaled by the solver's overflow penalty,
+/// in integer arithmetic
+template <typename T>
+struct StandardCost {
+	typedef int Cost;
+
+	EdgeState::Fields<T> edges;
+	int penalty;
+
+	Cost operator()(int id) const
+	{
+		return 1 + penalty * edges.util(id) / (edges.cap(id) + 1);
+	}
+
+	bool usable(int) const { return true; }
+};
+
+/// Sigmoid of utilization plus history weight over capacity (Options::NC)
+template <typename T>
+struct NCCost {
+	typedef double Cost;
+
+	EdgeState::Fields<T> edges;
+	const NCCostTable &table;
+
+	Cost operator()(int id) const
+	{
+		return table.cost(edges.util(id) + edges.weight(id), edges.cap(id));
+	}
+
+	bool usable(int) const { return true; }
+};
+
+/// Present congestion times accumulated history (Options::PathFinder)
+template <typename T>
+struct PathFinderCost {
+	typedef double Cost;
+
+	EdgeState::Fields<T> edges;
+	const NegotiatedCongestion &negotiation;
+
+	Cost operator()(int id) const
+	{
+		return negotiation.cost(edges.util(id), edges.cap(id), edges.history(id));
+	}
+
+	bool usable(int) const { return true; }
+};
+
+/// Another policy restricted to edges with spare capacity, for searches
+/// that must not add overflow. Edges in `own` (counts of the net's paths on
+/// each edge) stay usable however full they are, as the net already counts
+/// towards their utilization.
+template <typename Policy, typename T>
+struct SpareCapacityOnly {
+	typedef typename Policy::Cost Cost;
+
+	Policy policy;
+	EdgeState::Fields<T> edges;
+	const std::unordered_map<int, int> &own;
+
+	Cost operator()(int id) const { return policy(id); }
+
+	bool usable(int id) const
+	{
+		if(edges.util(id) < edges.cap(id)) return true;
+
+		const auto it = own.find(id);
+		return it != own.end() && it->second > 0;
+	}
+};
+
+template <typename Policy, typename T>
+SpareCapacityOnly<Policy, T> spareCapacityOnly(const Policy &policy, const EdgeState::Fields<T> &edges,
+                                               const std::unordered_map<int, int> &own)
+{
+	return SpareCapacityOnly<Policy, T>{policy, edges, own};
+}
+
+#endif // COSTPOLICIES_HPP_N5WB7T
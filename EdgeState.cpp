@@ -0,0 +1,663 @@
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "EdgeState.hpp"
+#include "BinaryIO.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EDGESTATE_HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Scalar kernels. Each one works on the half-open range [begin, end) of the
+// padded arrays; begin and end are always multiples of EdgeState::lanes.
+
+template <typename T>
+int countViolationsScalar(const T *util, const T *cap, size_t begin, size_t end)
+{
+	int v = 0;
+	for(size_t i = begin; i < end; ++i) {
+		v += util[i] > cap[i];
+	}
+	return v;
+}
+
+template <typename T>
+int maxOverflowScalar(const T *util, const T *cap, size_t begin, size_t end)
+{
+	int m = 0;
+	for(size_t i = begin; i < end; ++i) {
+		m = max(m, int(util[i]) - int(cap[i]));
+	}
+	return m;
+}
+
+template <typename T>
+EdgeState::Totals totalsScalar(const T *util, const T *cap, size_t begin, size_t end)
+{
+	EdgeState::Totals t;
+	for(size_t i = begin; i < end; ++i) {
+		t.overflow += max(0, int(util[i]) - int(cap[i]));
+		t.util += util[i];
+	}
+	return t;
+}
+
+template <typename T>
+void updateWeightsScalar(const T *util, const T *cap, T *overflowCount, T *weight, T *history,
+                         size_t begin, size_t end)
+{
+	const long long maxValue = numeric_limits<T>::max();
+
+	for(size_t i = begin; i < end; ++i) {
+		const int overflow = int(util[i]) - int(cap[i]);
+
+		if(overflow > 0) {
+			if(overflowCount[i] < maxValue) overflowCount[i]++;
+			weight[i] = T(min(maxValue, (long long)overflow * overflowCount[i]));
+			history[i] = T(min(maxValue, (long long)history[i] + overflow));
+		}
+		else {
+			weight[i] = 0;
+		}
+	}
+}
+
+#ifdef EDGESTATE_HAVE_AVX2_KERNELS
+
+// AVX2 versions of the above. They are compiled for AVX2 regardless of the
+// global -m flags and only called once the CPU has been checked for support.
+// Lanes<T> widens eight elements of T into 32-bit lanes and narrows them back
+// with unsigned saturation, so the kernels themselves only deal in int32.
+
+template <typename T>
+struct Lanes;
+
+template <>
+struct Lanes<int> {
+	__attribute__((target("avx2")))
+	static __m256i load(const int *p)
+	{
+		return _mm256_load_si256(reinterpret_cast<const __m256i *>(p));
+	}
+
+	__attribute__((target("avx2")))
+	static void store(int *p, __m256i v)
+	{
+		_mm256_store_si256(reinterpret_cast<__m256i *>(p), v);
+	}
+};
+
+template <>
+struct Lanes<uint16_t> {
+	__attribute__((target("avx2")))
+	static __m256i load(const uint16_t *p)
+	{
+		return _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i *>(p)));
+	}
+
+	/// Pack to 16 bits (per 128-bit half), then gather the two halves' low quadwords
+	__attribute__((target("avx2")))
+	static __m128i pack(__m256i v)
+	{
+		return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08));
+	}
+
+	__attribute__((target("avx2")))
+	static void store(uint16_t *p, __m256i v)
+	{
+		_mm_store_si128(reinterpret_cast<__m128i *>(p), pack(v));
+	}
+};
+
+template <>
+struct Lanes<uint8_t> {
+	__attribute__((target("avx2")))
+	static __m256i load(const uint8_t *p)
+	{
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)));
+	}
+
+	__attribute__((target("avx2")))
+	static void store(uint8_t *p, __m256i v)
+	{
+		__m128i words = Lanes<uint16_t>::pack(v);
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(p), _mm_packus_epi16(words, words));
+	}
+};
+
+__attribute__((target("avx2")))
+int horizontalSum(__m256i v)
+{
+	alignas(32) int parts[EdgeState::lanes];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(parts), v);
+	int r = 0;
+	for(int p : parts) r += p;
+	return r;
+}
+
+__attribute__((target("avx2")))
+int horizontalMax(__m256i v)
+{
+	alignas(32) int parts[EdgeState::lanes];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(parts), v);
+	return *max_element(begin(parts), end(parts));
+}
+
+__attribute__((target("avx2")))
+long long horizontalSum64(__m256i v)
+{
+	alignas(32) long long parts[4];
+	_mm256_store_si256(reinterpret_cast<__m256i *>(parts), v);
+	return parts[0] + parts[1] + parts[2] + parts[3];
+}
+
+/// Add the eight 32-bit lanes of v to the four 64-bit lanes of acc
+__attribute__((target("avx2")))
+__m256i addWidened(__m256i acc, __m256i v)
+{
+	acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+	return _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+int countViolationsAvx2(const T *util, const T *cap, size_t begin, size_t end)
+{
+	// cmpgt yields -1 in each overflowing lane, so subtracting it counts
+	__m256i acc = _mm256_setzero_si256();
+	for(size_t i = begin; i < end; i += EdgeState::lanes) {
+		__m256i u = Lanes<T>::load(util + i);
+		__m256i c = Lanes<T>::load(cap + i);
+		acc = _mm256_sub_epi32(acc, _mm256_cmpgt_epi32(u, c));
+	}
+	return horizontalSum(acc);
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+int maxOverflowAvx2(const T *util, const T *cap, size_t begin, size_t end)
+{
+	__m256i acc = _mm256_setzero_si256();
+	for(size_t i = begin; i < end; i += EdgeState::lanes) {
+		__m256i u = Lanes<T>::load(util + i);
+		__m256i c = Lanes<T>::load(cap + i);
+		acc = _mm256_max_epi32(acc, _mm256_sub_epi32(u, c));
+	}
+	return horizontalMax(acc);
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+EdgeState::Totals totalsAvx2(const T *util, const T *cap, size_t begin, size_t end)
+{
+	// Sums are kept in 64-bit lanes, as int lanes could overflow on large grids
+	const __m256i zero = _mm256_setzero_si256();
+	__m256i overflow = zero, total = zero;
+	for(size_t i = begin; i < end; i += EdgeState::lanes) {
+		__m256i u = Lanes<T>::load(util + i);
+		__m256i c = Lanes<T>::load(cap + i);
+		overflow = addWidened(overflow, _mm256_max_epi32(zero, _mm256_sub_epi32(u, c)));
+		total = addWidened(total, u);
+	}
+
+	EdgeState::Totals t;
+	t.overflow = horizontalSum64(overflow);
+	t.util = horizontalSum64(total);
+	return t;
+}
+
+/// a * b in each lane of nonnegative a and b, clamped to the largest T.
+/// The products are formed in 64 bits, even lanes and odd lanes apart.
+template <typename T>
+__attribute__((target("avx2")))
+__m256i mulSaturated(__m256i a, __m256i b)
+{
+	const __m256i limit = _mm256_set1_epi64x(numeric_limits<T>::max());
+	__m256i even = _mm256_mul_epu32(a, b);
+	__m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), _mm256_srli_epi64(b, 32));
+	even = _mm256_blendv_epi8(even, limit, _mm256_cmpgt_epi64(even, limit));
+	odd = _mm256_blendv_epi8(odd, limit, _mm256_cmpgt_epi64(odd, limit));
+	return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+void updateWeightsAvx2(const T *util, const T *cap, T *overflowCount, T *weight, T *history,
+                       size_t begin, size_t end)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i limit = _mm256_set1_epi32(numeric_limits<T>::max());
+	for(size_t i = begin; i < end; i += EdgeState::lanes) {
+		__m256i u = Lanes<T>::load(util + i);
+		__m256i c = Lanes<T>::load(cap + i);
+		__m256i k = Lanes<T>::load(overflowCount + i);
+		__m256i h = Lanes<T>::load(history + i);
+
+		__m256i overflow = _mm256_sub_epi32(u, c);
+		__m256i over = _mm256_cmpgt_epi32(overflow, zero);
+
+		overflow = _mm256_and_si256(over, overflow);
+
+		// Every lane is nonnegative, so sums fit in 32 unsigned bits and
+		// an unsigned min saturates them
+		k = _mm256_min_epu32(_mm256_sub_epi32(k, over), limit);
+		__m256i w = mulSaturated<T>(overflow, k);
+		h = _mm256_min_epu32(_mm256_add_epi32(h, overflow), limit);
+
+		Lanes<T>::store(overflowCount + i, k);
+		Lanes<T>::store(weight + i, w);
+		Lanes<T>::store(history + i, h);
+	}
+}
+
+bool haveAvx2()
+{
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+}
+
+/// Run the scalar and AVX2 weight updates side by side for a few rounds on
+/// every combination of values near 0 and near the largest T, and throw
+/// std::logic_error at the first element where they disagree
+template <typename T>
+void compareUpdateWeights()
+{
+	const int m = numeric_limits<T>::max();
+	const int values[] = {0, 1, 2, m / 2, m / 2 + 1, m - 2, m - 1, m};
+
+	EdgeState::Arrays<T> scalar;
+	for(int u : values) for(int c : values) for(int k : values) for(int h : values) {
+		scalar[EdgeState::Util].push_back(T(u));
+		scalar[EdgeState::Cap].push_back(T(c));
+		scalar[EdgeState::OverflowCount].push_back(T(k));
+		scalar[EdgeState::Weight].push_back(0);
+		scalar[EdgeState::History].push_back(T(h));
+	}
+	EdgeState::Arrays<T> avx2 = scalar;
+	const size_t n = scalar[EdgeState::Util].size();
+
+	auto run = [n](EdgeState::Arrays<T> &a, void (*kernel)(const T *, const T *, T *, T *, T *, size_t, size_t)) {
+		kernel(a[EdgeState::Util].data(), a[EdgeState::Cap].data(), a[EdgeState::OverflowCount].data(),
+		       a[EdgeState::Weight].data(), a[EdgeState::History].data(), 0, n);
+	};
+
+	const char *const names[] = {"utilization", "capacity", "overflow count", "weight", "history"};
+	const unsigned bits = 8 * sizeof(T);
+	for(int round = 1; round <= 3; ++round) {
+		run(scalar, updateWeightsScalar<T>);
+		run(avx2, updateWeightsAvx2<T>);
+
+		for(int f = EdgeState::OverflowCount; f < EdgeState::NumFields; ++f) {
+			for(size_t i = 0; i < n; ++i) {
+				if(scalar[f][i] == avx2[f][i]) continue;
+
+				stringstream ss;
+				ss << "edge state test failed on " << bits << "-bit storage: in update " << round
+				   << ", the " << names[f] << " of an edge with utilization " << +scalar[EdgeState::Util][i]
+				   << " and capacity " << +scalar[EdgeState::Cap][i] << " is " << +scalar[f][i]
+				   << " from the scalar kernel but " << +avx2[f][i] << " from the AVX2 one";
+				throw logic_error(ss.str());
+			}
+		}
+	}
+	cout << bits << "-bit weight update: " << n << " edges OK\n";
+}
+
+#endif // EDGESTATE_HAVE_AVX2_KERNELS
+
+// Dispatch to the widest kernel the CPU supports
+
+template <typename T>
+int countViolationsKernel(const T *util, const T *cap, size_t begin, size_t end)
+{
+#ifdef EDGESTATE_HAVE_AVX2_KERNELS
+	if(haveAvx2()) return countViolationsAvx2(util, cap, begin, end);
+#endif
+	return countViolationsScalar(util, cap, begin, end);
+}
+
+template <typename T>
+int maxOverflowKernel(const T *util, const T *cap, size_t begin, size_t end)
+{
+#ifdef EDGESTATE_HAVE_AVX2_KERNELS
+	if(haveAvx2()) return maxOverflowAvx2(util, cap, begin, end);
+#endif
+	return maxOverflowScalar(util, cap, begin, end);
+}
+
+template <typename T>
+EdgeState::Totals totalsKernel(const T *util, const T *cap, size_t begin, size_t end)
+{
+#ifdef EDGESTATE_HAVE_AVX2_KERNELS
+	if(haveAvx2()) return totalsAvx2(util, cap, begin, end);
+#endif
+	return totalsScalar(util, cap, begin, end);
+}
+
+template <typename T>
+void updateWeightsKernel(const T *util, const T *cap, T *overflowCount, T *weight, T *history,
+                         size_t begin, size_t end)
+{
+#ifdef EDGESTATE_HAVE_AVX2_KERNELS
+	if(haveAvx2()) {
+		updateWeightsAvx2(util, cap, overflowCount, weight, history, begin, end);
+		return;
+	}
+#endif
+	updateWeightsScalar(util, cap, overflowCount, weight, history, begin, end);
+}
+
+/// Run kernel(begin, end) over [0, n), splitting the range across hardware
+/// threads for large grids, and fold the partial results with combine.
+/// Chunk boundaries stay multiples of EdgeState::lanes.
+template <typename R, typename K, typename C>
+R forChunks(size_t n, const K &kernel, const C &combine)
+{
+	const size_t threads = max(1u, thread::hardware_concurrency());
+	if(n < EdgeState::parallelThreshold || threads == 1) {
+		return kernel(size_t(0), n);
+	}
+
+	const size_t lanes = EdgeState::lanes;
+	const size_t step = (n / threads + lanes - 1) / lanes * lanes;
+
+	vector<future<R>> futures;
+	for(size_t b = 0; b < n; b += step) {
+		const size_t e = min(n, b + step);
+		futures.emplace_back(async(launch::async, [&kernel, b, e] {
+			return kernel(b, e);
+		}));
+	}
+
+	R result = futures[0].get();
+	for(auto it = futures.begin() + 1; it != futures.end(); ++it) {
+		result = combine(result, it->get());
+	}
+	return result;
+}
+
+template <typename T>
+int countViolations(const EdgeState::Arrays<T> &a)
+{
+	const T *u = a[EdgeState::Util].data();
+	const T *c = a[EdgeState::Cap].data();
+
+	return forChunks<int>(a[EdgeState::Util].size(), [=](size_t b, size_t e) {
+		return countViolationsKernel(u, c, b, e);
+	}, [](int x, int y) { return x + y; });
+}
+
+template <typename T>
+int maxOverflow(const EdgeState::Arrays<T> &a)
+{
+	const T *u = a[EdgeState::Util].data();
+	const T *c = a[EdgeState::Cap].data();
+
+	return forChunks<int>(a[EdgeState::Util].size(), [=](size_t b, size_t e) {
+		return maxOverflowKernel(u, c, b, e);
+	}, [](int x, int y) { return max(x, y); });
+}
+
+template <typename T>
+EdgeState::Totals totals(const EdgeState::Arrays<T> &a)
+{
+	const T *u = a[EdgeState::Util].data();
+	const T *c = a[EdgeState::Cap].data();
+
+	return forChunks<EdgeState::Totals>(a[EdgeState::Util].size(), [=](size_t b, size_t e) {
+		return totalsKernel(u, c, b, e);
+	}, [](EdgeState::Totals x, EdgeState::Totals y) {
+		x.overflow += y.overflow;
+		x.util += y.util;
+		return x;
+	});
+}
+
+template <typename T>
+void updateWeights(EdgeState::Arrays<T> &a)
+{
+	const T *u = a[EdgeState::Util].data();
+	const T *c = a[EdgeState::Cap].data();
+	T *k = a[EdgeState::OverflowCount].data();
+	T *w = a[EdgeState::Weight].data();
+	T *h = a[EdgeState::History].data();
+
+	forChunks<int>(a[EdgeState::Util].size(), [=](size_t b, size_t e) {
+		updateWeightsKernel(u, c, k, w, h, b, e);
+		return 0;
+	}, [](int, int) { return 0; });
+}
+
+/// Move every field of from into to, converting element types
+template <typename From, typename To>
+void convert(EdgeState::Arrays<From> &from, EdgeState::Arrays<To> &to)
+{
+	for(int f = 0; f < EdgeState::NumFields; ++f) {
+		to[f].assign(from[f].begin(), from[f].end());
+		EdgeState::Array<From>().swap(from[f]);
+	}
+}
+
+/// Largest utilization or capacity in a
+template <typename T>
+int maxExactValue(const EdgeState::Arrays<T> &a)
+{
+	int m = 0;
+	for(int f : {EdgeState::Util, EdgeState::Cap}) {
+		if(!a[f].empty()) m = max<int>(m, *max_element(a[f].begin(), a[f].end()));
+	}
+	return m;
+}
+
+/// Clamp overflow counts, weights and history to what a narrower type can hold
+template <typename T>
+void saturateHistory(EdgeState::Arrays<T> &a, int maxValue)
+{
+	for(int f : {EdgeState::OverflowCount, EdgeState::Weight, EdgeState::History}) {
+		for(auto &v : a[f]) v = min<T>(v, maxValue);
+	}
+}
+
+size_t padded(size_t n)
+{
+	return (n + EdgeState::lanes - 1) / EdgeState::lanes * EdgeState::lanes;
+}
+
+template <typename T>
+void writeArrays(ostream &out, const EdgeState::Arrays<T> &a)
+{
+	for(const auto &field : a) writeBinary(out, field);
+}
+
+template <typename T>
+void readArrays(istream &in, EdgeState::Arrays<T> &a, size_t n)
+{
+	for(auto &field : a) {
+		readBinary(in, field);
+		if(field.size() != n) {
+			throw runtime_error("Saved edge state has " + to_string(field.size()) +
+			                    " elements per field instead of " + to_string(n));
+		}
+	}
+}
+
+} // end anonymous namespace
+
+unsigned EdgeState::bitsHolding(int value)
+{
+	if(value <= numeric_limits<uint8_t>::max()) return 8;
+	if(value <= numeric_limits<uint16_t>::max()) return 16;
+	return 32;
+}
+
+unsigned EdgeState::bitsFor(int maxCap)
+{
+	return maxCap > numeric_limits<int>::max() / 2 ? 32 : bitsHolding(2 * maxCap);
+}
+
+void EdgeState::reset(const CapacityMap &caps, const GridGeometry &grid, int defaultCap, unsigned bits)
+{
+	numIDs = grid.idSpace();
+	const size_t n = padded(numIDs);
+
+	for(int f = 0; f < NumFields; ++f) {
+		Array<uint8_t>().swap(narrow8[f]);
+		Array<uint16_t>().swap(narrow16[f]);
+		wide[f].assign(n, 0);
+	}
+	storageBits = 32;
+
+	if(grid.layout == GridGeometry::RowMajor) {
+		fill(wide[Cap].begin(), wide[Cap].begin() + numIDs, defaultCap);
+	}
+	else {
+		for(size_t i = 0; i < numIDs; ++i) {
+			if(grid.isEdge(i)) wide[Cap][i] = defaultCap;
+		}
+	}
+	for(const auto &o : caps.entries()) {
+		if(static_cast<size_t>(o.first) < numIDs) wide[Cap][o.first] = o.second;
+	}
+
+	setBits(bits);
+}
+
+void EdgeState::write(ostream &out) const
+{
+	writeBinary(out, static_cast<uint64_t>(numIDs));
+	writeBinary(out, storageBits);
+	switch(storageBits) {
+		case 8: writeArrays(out, narrow8); break;
+		case 16: writeArrays(out, narrow16); break;
+		default: writeArrays(out, wide); break;
+	}
+}
+
+void EdgeState::read(istream &in)
+{
+	const auto ids = readBinary<uint64_t>(in);
+	if(ids != numIDs) {
+		throw runtime_error("Saved edge state is for " + to_string(ids) + " edge IDs, not " + to_string(numIDs));
+	}
+
+	const auto bits = readBinary<unsigned>(in);
+	if(bits != 8 && bits != 16 && bits != 32) {
+		throw runtime_error("Saved edge state has an invalid width of " + to_string(bits) + " bits");
+	}
+
+	for(int f = 0; f < NumFields; ++f) {
+		Array<uint8_t>().swap(narrow8[f]);
+		Array<uint16_t>().swap(narrow16[f]);
+		Array<int>().swap(wide[f]);
+	}
+	switch(bits) {
+		case 8: readArrays(in, narrow8, padded(numIDs)); break;
+		case 16: readArrays(in, narrow16, padded(numIDs)); break;
+		default: readArrays(in, wide, padded(numIDs)); break;
+	}
+	storageBits = bits;
+}
+
+void EdgeState::setBits(unsigned bits)
+{
+	if(bits != 8 && bits != 16 && bits != 32) {
+		throw runtime_error("Edge storage width must be 8, 16 or 32 bits, not " + to_string(bits));
+	}
+	if(bits == storageBits) return;
+
+	if(bits > storageBits) {
+		promote(bits);
+		return;
+	}
+
+	const int largest = storageBits == 16 ? maxExactValue(narrow16) : maxExactValue(wide);
+	if(bitsHolding(largest) > bits) {
+		throw runtime_error("Edge utilizations and capacities (up to " + to_string(largest) +
+		                    ") do not fit in " + to_string(bits) + " bits");
+	}
+
+	const int limit = bits == 8 ? numeric_limits<uint8_t>::max() : numeric_limits<uint16_t>::max();
+	if(storageBits == 32) {
+		saturateHistory(wide, limit);
+		if(bits == 16) convert(wide, narrow16);
+		else convert(wide, narrow8);
+	}
+	else {
+		saturateHistory(narrow16, limit);
+		convert(narrow16, narrow8);
+	}
+	storageBits = bits;
+}
+
+void EdgeState::promote(unsigned bits)
+{
+	assert(bits > storageBits);
+
+	if(storageBits == 8) {
+		if(bits == 16) convert(narrow8, narrow16);
+		else convert(narrow8, wide);
+	}
+	else {
+		convert(narrow16, wide);
+	}
+	storageBits = bits;
+}
+
+int EdgeState::countViolations() const
+{
+	switch(storageBits) {
+		case 8: return ::countViolations(narrow8);
+		case 16: return ::countViolations(narrow16);
+		default: return ::countViolations(wide);
+	}
+}
+
+int EdgeState::maxOverflow() const
+{
+	switch(storageBits) {
+		case 8: return ::maxOverflow(narrow8);
+		case 16: return ::maxOverflow(narrow16);
+		default: return ::maxOverflow(wide);
+	}
+}
+
+EdgeState::Totals EdgeState::totals() const
+{
+	switch(storageBits) {
+		case 8: return ::totals(narrow8);
+		case 16: return ::totals(narrow16);
+		default: return ::totals(wide);
+	}
+}
+
+void EdgeState::updateWeights()
+{
+	switch(storageBits) {
+		case 8: ::updateWeights(narrow8); break;
+		case 16: ::updateWeights(narrow16); break;
+		default: ::updateWeights(wide); break;
+	}
+}
+
+void testEdgeState()
+{
+#ifdef EDGESTATE_HAVE_AVX2_KERNELS
+	if(haveAvx2()) {
+		compareUpdateWeights<uint8_t>();
+		compareUpdateWeights<uint16_t>();
+		compareUpdateWeights<int>();
+		return;
+	}
+#endif
+	cout << "weight update: no AVX2 kernels to compare\n";
+}
@@ -0,0 +1,198 @@
+#ifndef EDGESTATE_HPP_Q3M8ZK
+#define EDGESTATE_HPP_Q3M8ZK
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <vector>
+#include "AlignedAllocator.hpp"
+#include "CapacityMap.hpp"
+#include "GridGeometry.hpp"
+
+/// Per-edge routing state, kept as a structure of arrays indexed by edge ID.
+///
+/// The full-grid passes of the router (violation counts, weight updates,
+/// maximum overflow) stream over utilization and capacity together, so each
+/// field lives in its own 32-byte aligned array and those passes run as AVX2
+/// kernels when the CPU supports them. Every array is padded to a multiple of
+/// `lanes` elements with zero utilization and capacity, which never counts as
+/// overflow, so the kernels need no scalar tail.
+///
+/// All four fields are stored with the same element width: 8, 16 or 32 bits.
+/// Narrow storage lets far more of a large grid stay in cache. Utilization and
+/// capacity are always exact: callers widen the state with widenFor() before
+/// storing a value that would not fit, between searches rather than inside
+/// them. Overflow counts, weights and history are heuristics and saturate at
+/// the largest value of the storage type instead.
+///
+/// get() and set() pick the width on every call. Loops over many edges, such
+/// as the maze router's, pick it once and read through fields<T>() instead.
+class EdgeState {
+public:
+	static const std::size_t lanes = 8; ///< 32-bit elements per AVX2 register
+
+	/// Grids with at least this many edges split full-grid passes across threads
+	static const std::size_t parallelThreshold = 1 << 20;
+
+	enum Field {
+		Util,          ///< edge utilization
+		Cap,           ///< edge capacity after considering blockages
+		OverflowCount, ///< k_e^k: number of iterations the edge has overflowed
+		Weight,        ///< w_e^k: history weight of the edge
+		History,       ///< total overflow of the edge summed over all iterations
+		NumFields
+	};
+
+	template <typename T>
+	using Array = std::vector<T, AlignedAllocator<T, 32>>;
+
+	template <typename T>
+	using Arrays = std::array<Array<T>, NumFields>;
+
+	/// Read-only view of the fields at one storage width, T. It stays valid
+	/// until the width changes.
+	template <typename T>
+	class Fields {
+	public:
+		explicit Fields(const Arrays<T> &arrays)
+		{
+			for(int f = 0; f < NumFields; ++f) field[f] = arrays[f].data();
+		}
+
+		int util(std::size_t i) const { return field[Util][i]; }
+		int cap(std::size_t i) const { return field[Cap][i]; }
+		int overflowCount(std::size_t i) const { return field[OverflowCount][i]; }
+		int weight(std::size_t i) const { return field[Weight][i]; }
+		int history(std::size_t i) const { return field[History][i]; }
+
+	private:
+		std::array<const T *, NumFields> field;
+	};
+
+	/// Smallest storage width (in bits) that holds value
+	static unsigned bitsHolding(int value);
+
+	/// Storage width (in bits) to use for a grid whose largest capacity is
+	/// maxCap, leaving room for edges to be overflowed by as much again.
+	static unsigned bitsFor(int maxCap);
+
+	/// Size the arrays for every edge ID of grid, stored in `bits`-bit elements,
+	/// and load their capacities. Edges without an entry in caps get defaultCap;
+	/// IDs that are holes in the grid's layout get zero capacity.
+	void reset(const CapacityMap &caps, const GridGeometry &grid, int defaultCap, unsigned bits = 32);
+
+	/// Convert to `bits`-bit storage. Throws std::runtime_error when narrowing
+	/// and a utilization or capacity does not fit.
+	void setBits(unsigned bits);
+
+	/// Save every field at the current width, for read() to restore
+	void write(std::ostream &out) const;
+
+	/// Restore a state saved by write() on a grid with the same ID space,
+	/// as set up by reset(). Throws std::runtime_error if it doesn't match.
+	void read(std::istream &in);
+
+	unsigned bits() const { return storageBits; }
+
+	/// Widen storage, if needed, so that value fits
+	void widenFor(int value)
+	{
+		if(value > maxValue()) promote(bitsHolding(value));
+	}
+
+	/// The fields as stored, where T has bits() bits: uint8_t, uint16_t or int
+	template <typename T>
+	Fields<T> fields() const
+	{
+		assert(8 * sizeof(T) == storageBits);
+		return Fields<T>(arrays(static_cast<T *>(nullptr)));
+	}
+
+	/// Number of edge IDs (including any holes in the layout)
+	std::size_t size() const { return numIDs; }
+
+	int get(Field f, std::size_t i) const
+	{
+		switch(storageBits) {
+			case 8: return narrow8[f][i];
+			case 16: return narrow16[f][i];
+			default: return wide[f][i];
+		}
+	}
+
+	void set(Field f, std::size_t i, int value)
+	{
+		assert(value >= 0 && value <= maxValue());
+
+		switch(storageBits) {
+			case 8: narrow8[f][i] = static_cast<uint8_t>(value); break;
+			case 16: narrow16[f][i] = static_cast<uint16_t>(value); break;
+			default: wide[f][i] = value; break;
+		}
+	}
+
+	int util(std::size_t i) const { return get(Util, i); }
+	int cap(std::size_t i) const { return get(Cap, i); }
+	int overflowCount(std::size_t i) const { return get(OverflowCount, i); }
+	int weight(std::size_t i) const { return get(Weight, i); }
+	int history(std::size_t i) const { return get(History, i); }
+
+	void setUtil(std::size_t i, int value) { set(Util, i, value); }
+	void setCap(std::size_t i, int value) { set(Cap, i, value); }
+	void addUtil(std::size_t i, int delta) { set(Util, i, get(Util, i) + delta); }
+
+	/// Number of edges with utilization above capacity
+	int countViolations() const;
+
+	/// Largest (utilization - capacity) over all edges, or 0 if none overflow
+	int maxOverflow() const;
+
+	struct Totals {
+		long long overflow = 0; ///< summed overflow of all edges (TOF)
+		long long util = 0;     ///< summed utilization, which is the total wirelength
+	};
+
+	/// Total overflow and total utilization in one pass
+	Totals totals() const;
+
+	/// Bump overflowCount on overflowing edges, set weight to
+	/// overflow * overflowCount there and add the overflow to history.
+	/// weight is cleared on edges that are not overflowed.
+	void updateWeights();
+
+private:
+	std::size_t numIDs = 0;
+	unsigned storageBits = 32;
+
+	// Only the arrays matching storageBits are populated
+	Arrays<uint8_t> narrow8;
+	Arrays<uint16_t> narrow16;
+	Arrays<int> wide;
+
+	int maxValue() const
+	{
+		switch(storageBits) {
+			case 8: return std::numeric_limits<uint8_t>::max();
+			case 16: return std::numeric_limits<uint16_t>::max();
+			default: return std::numeric_limits<int>::max();
+		}
+	}
+
+	const Arrays<uint8_t> &arrays(uint8_t *) const { return narrow8; }
+	const Arrays<uint16_t> &arrays(uint16_t *) const { return narrow16; }
+	const Arrays<int> &arrays(int *) const { return wide; }
+
+	void promote(unsigned bits);
+};
+
+/// Compare the AVX2 weight update against the scalar one at each storage
+/// width, on values near zero and near the width's largest value, where
+/// both must saturate alike. Does nothing without AVX2.
+/// Throws std::logic_error describing the first mismatch.
+void testEdgeState();
+
+#endif // EDGESTATE_HPP_Q3M8ZK
@@ -0,0 +1,194 @@
+/// \file
+#ifndef GRIDGEOMETRY_HPP_7DWQ4C
+#define GRIDGEOMETRY_HPP_7DWQ4C
+
+#include <cassert>
+#include "ece556.hpp"
+
+/// Edge ID arithmetic for a routing grid, kept in a header so every caller
+/// (the A* inner loop in particular) gets it inlined.
+///
+/// Two layouts are supported:
+///
+/// - RowMajor numbers all horizontal edges first: the horizontal edge
+///   (x,y)-(x+1,y) is `(width-1)*y + x` and the vertical edge (x,y)-(x,y+1)
+///   is `(width-1)*height + width*y + x`. IDs are dense.
+/// - Tiled groups cells into `tileSize` by `tileSize` tiles stored one after
+///   another, with each cell's east and north edges next to each other.
+///   All four edges around a cell, and those of its neighbours, sit within
+///   a few cache lines. Edges past the east and north borders and cells
+///   padding out partial tiles leave holes in the ID space, so arrays indexed
+///   by edge ID must be idSpace() long and skip IDs where isEdge() is false.
+struct GridGeometry {
+	enum Layout { RowMajor, Tiled };
+
+	static constexpr int tileBits = 3; ///< log2 of the tile side in cells
+	static constexpr int tileSize = 1 << tileBits;
+	static constexpr int tileMask = tileSize - 1;
+
+	int width;  ///< number of vertical divisions (gx)
+	int height; ///< number of horizontal divisions (gy)
+	Layout layout;
+
+	/// Directions to a neighbouring cell, in the order
+	/// RoutingSolver::neighbor() visits them
+	enum Direction { West, East, South, North };
+
+	/// The two edges a cell owns: the one to its east and the one to its north.
+	/// The cell's other two edges belong to its western and southern neighbours.
+	struct CellEdges {
+		int x, y;  ///< the cell
+		int east;  ///< ID of (x,y)-(x+1,y)
+		int north; ///< ID of (x,y)-(x,y+1)
+	};
+
+	constexpr GridGeometry(int width, int height, Layout layout = RowMajor)
+	: width(width)
+	, height(height)
+	, layout(layout)
+	{ }
+
+	constexpr int numHorizontalEdges() const { return (width - 1) * height; }
+	constexpr int numVerticalEdges() const { return width * (height - 1); }
+	constexpr int numEdges() const { return numHorizontalEdges() + numVerticalEdges(); }
+
+	/// One past the largest edge ID; the length of arrays indexed by edge ID
+	constexpr int idSpace() const
+	{
+		return layout == RowMajor ? numEdges() : 2 * (tilesPerRow() * tilesPerColumn() << (2 * tileBits));
+	}
+
+	constexpr int horizontalEdgeID(int x, int y) const
+	{
+		return layout == RowMajor ? (width - 1) * y + x : 2 * tiledCellIndex(x, y);
+	}
+
+	constexpr int verticalEdgeID(int x, int y) const
+	{
+		return layout == RowMajor ? numHorizontalEdges() + width * y + x : 2 * tiledCellIndex(x, y) + 1;
+	}
+
+	constexpr bool isVertical(int edgeID) const
+	{
+		return layout == RowMajor ? edgeID >= numHorizontalEdges() : (edgeID & 1) != 0;
+	}
+
+	/// Whether edgeID names an edge of the grid rather than a hole in the ID space
+	constexpr bool isEdge(int edgeID) const
+	{
+		return edgeID >= 0 && edgeID < idSpace() &&
+		       (layout == RowMajor || isInsideTiled(edge(edgeID)));
+	}
+
+	constexpr bool contains(const Point &p) const
+	{
+		return p.x >= 0 && p.y >= 0 && p.x < width && p.y < height;
+	}
+
+	/// Whether p1 and p2 are grid points one unit apart, so edgeID(p1, p2) is defined
+	constexpr bool isUnitEdge(const Point &p1, const Point &p2) const
+	{
+		return contains(p1) && contains(p2) &&
+		       ((p1.x == p2.x && (p1.y - p2.y == 1 || p2.y - p1.y == 1)) ||
+		        (p1.y == p2.y && (p1.x - p2.x == 1 || p2.x - p1.x == 1)));
+	}
+
+	/// ID of the unit edge between (x1,y1) and (x2,y2), in either order
+	constexpr int edgeID(int x1, int y1, int x2, int y2) const
+	{
+		return assert((x1 == x2 && (y2 - y1 == 1 || y1 - y2 == 1)) ||
+		              (y1 == y2 && (x2 - x1 == 1 || x1 - x2 == 1))),
+		       y1 == y2 ? horizontalEdgeID(x1 < x2 ? x1 : x2, y1)
+		                : verticalEdgeID(x1, y1 < y2 ? y1 : y2);
+	}
+
+	constexpr int edgeID(const Point &p1, const Point &p2) const
+	{
+		return edgeID(p1.x, p1.y, p2.x, p2.y);
+	}
+
+	constexpr int edgeID(const Edge &e) const
+	{
+		return edgeID(e.p1, e.p2);
+	}
+
+	/// Convert an edge ID back into an Edge with p1 at its lower-left end
+	constexpr Edge edge(int edgeID) const
+	{
+		return layout == RowMajor
+			? rowMajorEdge(isVertical(edgeID), edgeID - isVertical(edgeID) * numHorizontalEdges())
+			: tiledEdge(edgeID & 1, edgeID >> 1);
+	}
+
+	constexpr CellEdges cellEdges(int x, int y) const
+	{
+		return CellEdges{x, y, horizontalEdgeID(x, y), verticalEdgeID(x, y)};
+	}
+
+	constexpr CellEdges cellEdges(const Point &p) const
+	{
+		return cellEdges(p.x, p.y);
+	}
+
+	/// ID of the edge from the cell c toward its neighbour in direction d
+	constexpr int edgeToward(CellEdges c, Direction d) const
+	{
+		return d == East ? c.east
+		     : d == North ? c.north
+		     : layout == RowMajor ? (d == West ? c.east - 1 : c.north - width)
+		     : d == West ? horizontalEdgeID(c.x - 1, c.y)
+		     : verticalEdgeID(c.x, c.y - 1);
+	}
+
+	/// Edge IDs of the neighbouring cell in direction d. In the row-major
+	/// layout moving a cell is an add: horizontal edge rows are width-1 long
+	/// and vertical ones width long.
+	constexpr CellEdges step(CellEdges c, Direction d) const
+	{
+		return layout == Tiled
+			? cellEdges(c.x + (d == East) - (d == West), c.y + (d == North) - (d == South))
+		     : d == West ? CellEdges{c.x - 1, c.y, c.east - 1, c.north - 1}
+		     : d == East ? CellEdges{c.x + 1, c.y, c.east + 1, c.north + 1}
+		     : d == South ? CellEdges{c.x, c.y - 1, c.east - (width - 1), c.north - width}
+		     : CellEdges{c.x, c.y + 1, c.east + (width - 1), c.north + width};
+	}
+
+private:
+	constexpr int tilesPerRow() const { return (width + tileMask) >> tileBits; }
+	constexpr int tilesPerColumn() const { return (height + tileMask) >> tileBits; }
+
+	/// Position of cell (x,y) in tile order: whole tiles row by row,
+	/// and cells row by row within each tile
+	constexpr int tiledCellIndex(int x, int y) const
+	{
+		return (((y >> tileBits) * tilesPerRow() + (x >> tileBits)) << (2 * tileBits)) +
+		       ((y & tileMask) << tileBits) + (x & tileMask);
+	}
+
+	/// Inverse of tiledCellIndex, returning the cell's east or north edge
+	constexpr Edge tiledEdge(bool vertical, int cell) const
+	{
+		return edgeAt(vertical,
+		              ((cell >> (2 * tileBits)) % tilesPerRow() << tileBits) + (cell & tileMask),
+		              ((cell >> (2 * tileBits)) / tilesPerRow() << tileBits) + ((cell >> tileBits) & tileMask));
+	}
+
+	constexpr bool isInsideTiled(const Edge &e) const
+	{
+		return e.p2.x < width && e.p2.y < height;
+	}
+
+	/// local is the index among edges of one orientation; the row stride is
+	/// width-1 for horizontal edges and width for vertical ones
+	constexpr Edge rowMajorEdge(bool vertical, int local) const
+	{
+		return edgeAt(vertical, local % (width - 1 + vertical), local / (width - 1 + vertical));
+	}
+
+	constexpr Edge edgeAt(bool vertical, int x, int y) const
+	{
+		return Edge{Point{x, y}, Point{x + !vertical, y + vertical}};
+	}
+};
+
+#endif // GRIDGEOMETRY_HPP_7DWQ4C
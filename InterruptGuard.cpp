@@ -0,0 +1,30 @@
+#include "InterruptGuard.hpp"
+
+#include <atomic>
+#include <csignal>
+
+namespace
+{
+	// Lock-free, so safe to set from the handler and read from any thread
+	std::atomic<bool> interrupted(false);
+
+	void handler(int n)
+	{
+		interrupted.store(true, std::memory_order_relaxed);
+		std::signal(n, SIG_DFL);
+	}
+}
+
+InterruptGuard::InterruptGuard()
+: previous(std::signal(SIGINT, &handler))
+{ }
+
+InterruptGuard::~InterruptGuard()
+{
+	std::signal(SIGINT, previous == SIG_ERR ? SIG_DFL : previous);
+}
+
+bool interruptRequested()
+{
+	return interrupted.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,24 @@
+/// \file
+#ifndef INTERRUPTGUARD_HPP_T7WE3J
+#define INTERRUPTGUARD_HPP_T7WE3J
+
+/// Turns ^C into a request to stop gracefully for as long as it exists:
+/// SIGINT then only sets a flag, which long-running loops poll with
+/// interruptRequested() from any thread, and a second ^C kills the process
+/// as usual. Install one for the whole of the work that polls, not one per
+/// loop or thread, so ^C never finds the default action in place partway
+/// through. The previous handler is restored on destruction.
+class InterruptGuard {
+	void (*previous)(int);
+public:
+	InterruptGuard();
+	~InterruptGuard();
+
+	InterruptGuard(const InterruptGuard &) = delete;
+	InterruptGuard &operator=(const InterruptGuard &) = delete;
+};
+
+/// Whether ^C was pressed while an InterruptGuard was installed
+bool interruptRequested();
+
+#endif // INTERRUPTGUARD_HPP_T7WE3J
@@ -13,7 +13,7 @@
 template <typename InputIt>
 std::vector<InputIt> partitionCollection(InputIt begin, InputIt end, size_t numPartitions)
 {
-	assert(numPartitions > 1); // Don't be stupid
+	assert(numPartitions > 0);
 
 	const size_t step = std::distance(begin, end) / numPartitions;
 
@@ -0,0 +1,102 @@
+/// \file
+#ifndef NCCOSTTABLE_HPP_Q8MZ2D
+#define NCCOSTTABLE_HPP_Q8MZ2D
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+#include "CapacityMap.hpp"
+
+/// Cost of an edge under the NC (sigmoid) cost function, tabulated once per
+/// rip-up and reroute iteration.
+///
+/// The cost is `1 + h / (1 + exp(-k * load / cap)) - h`, where load is the
+/// edge's utilization plus its weight and the slope k and height h depend
+/// only on the iteration. setCapacities() picks the capacities that occur
+/// in the instance, and for each of them every load below a few times the
+/// capacity is stored in a table, so the maze router's inner loop does a
+/// lookup rather than a call to exp. The table holds at most maxEntries
+/// costs: the capacities of the most edges get rows first, and the rest,
+/// like loads past the end of a row, fall back to evaluating the sigmoid.
+/// Table entries are computed with the same expression, so both paths give
+/// identical costs.
+class NCCostTable {
+public:
+	/// Most costs tabulated, bounding both the table's memory and the work
+	/// of rebuilding it every iteration
+	static const size_t maxEntries = 1 << 20;
+
+	/// Choose the rows to tabulate for edges of capacity defaultCap apart
+	/// from those in overrides, out of numEdges edges. Call rebuild() after.
+	void setCapacities(int defaultCap, const CapacityMap &overrides, long long numEdges)
+	{
+		std::map<int, long long> edgesWithCap;
+		edgesWithCap[defaultCap] += numEdges - overrides.entries().size();
+		for(const auto &o : overrides.entries()) ++edgesWithCap[o.second];
+
+		std::vector<std::pair<long long, int>> byCount; // (edges, capacity)
+		for(const auto &c : edgesWithCap) byCount.emplace_back(c.second, c.first);
+		std::sort(byCount.rbegin(), byCount.rend());
+
+		rows.clear();
+		size_t entries = 0;
+		for(const auto &c : byCount) {
+			const int cap = c.second;
+			const size_t loads = size_t(loadsPerCap) * (size_t(cap) + 1);
+			if(cap < 0 || entries + loads > maxEntries) continue;
+
+			if(size_t(cap) >= rows.size()) rows.resize(cap + 1);
+			rows[cap] = Row{entries, int(loads)};
+			entries += loads;
+		}
+		table.resize(entries);
+	}
+
+	/// Tabulate the cost for the given iteration
+	void rebuild(int iteration)
+	{
+		h = std::min(1.0, 0.5 + iteration / 100.0);
+		k = std::min(1.0, 0.01 + iteration / 100.0);
+
+		for(int cap = 0; cap < int(rows.size()); ++cap) {
+			const Row &row = rows[cap];
+			for(int l = 0; l < row.loads; ++l) {
+				table[row.offset + l] = sigmoid(l, cap);
+			}
+		}
+	}
+
+	double cost(int load, int cap) const
+	{
+		if(cap < int(rows.size())) {
+			const Row &row = rows[cap];
+			if(load < row.loads) return table[row.offset + load];
+		}
+		return sigmoid(load, cap);
+	}
+
+private:
+	/// Loads tabulated per unit of capacity; past a few times the capacity
+	/// the sigmoid has flattened out and such edges are rare
+	static const int loadsPerCap = 4;
+
+	/// Where the costs of one capacity start in table, and how many loads
+	/// they cover (none for capacities left out)
+	struct Row {
+		size_t offset;
+		int loads;
+	};
+
+	double sigmoid(int load, int cap) const
+	{
+		return 1 + h / (1.0 + std::exp(-k * load / cap)) - h;
+	}
+
+	double h = 0, k = 0;
+	std::vector<Row> rows; ///< by capacity
+	std::vector<double> table;
+};
+
+#endif // NCCOSTTABLE_HPP_Q8MZ2D
@@ -0,0 +1,47 @@
+/// \file
+#ifndef NEGOTIATEDCONGESTION_HPP_R3KX0M
+#define NEGOTIATEDCONGESTION_HPP_R3KX0M
+
+#include <algorithm>
+
+/// PathFinder-style negotiated congestion cost.
+///
+/// The cost of using an edge is `(b + h * history) * (1 + p * over)`, where
+/// `over` is how far past its capacity the edge would be with one more net on
+/// it and `history` is the overflow the edge has accumulated over all previous
+/// iterations (EdgeState::History). The present factor `p` starts small so
+/// nets may share edges early on, and grows every rip-up and reroute
+/// iteration until sharing becomes too expensive. History keeps edges that
+/// are congested iteration after iteration expensive even when the present
+/// congestion on them has been negotiated away.
+///
+/// The cost is never below `b` (1 by default), so the L1 distance heuristic of
+/// the maze router stays admissible. `p` stops growing at maxPresentFactor(),
+/// so it never becomes infinite and turns costs into NaN.
+struct NegotiatedCongestion {
+	double baseCost = 1;        ///< b: cost of an edge with no congestion
+	double presentFactor = 0.5; ///< p: weight of present overflow in the current iteration
+	double presentGrowth = 1.5; ///< p is multiplied by this after every iteration
+	double historyFactor = 1;   ///< h: weight of accumulated overflow
+
+	/// Largest p. Past this, one unit of overflow already costs more than a
+	/// detour across any grid the router can hold.
+	static double maxPresentFactor() { return 1e12; }
+
+	/// Cost of adding one more net to an edge with the given utilization,
+	/// capacity and accumulated overflow
+	double cost(int util, int cap, int history) const
+	{
+		const int over = util + 1 - cap;
+		const double base = baseCost + historyFactor * history;
+		return over > 0 ? base * (1 + presentFactor * over) : base;
+	}
+
+	/// Make present congestion more expensive for the next iteration
+	void nextIteration()
+	{
+		presentFactor = std::min(maxPresentFactor(), presentFactor * presentGrowth);
+	}
+};
+
+#endif // NEGOTIATEDCONGESTION_HPP_R3KX0M
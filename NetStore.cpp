@@ -0,0 +1,220 @@
+#include "NetStore.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+	runtime_error ioError(const string &what, const string &path)
+	{
+		return runtime_error(what + " " + path + ": " + strerror(errno));
+	}
+
+	template <typename T>
+	void append(vector<char> &buf, const T *values, size_t n)
+	{
+		const char *bytes = reinterpret_cast<const char *>(values);
+		buf.insert(buf.end(), bytes, bytes + n * sizeof(T));
+	}
+
+	template <typename T>
+	void append(vector<char> &buf, const T &value)
+	{
+		append(buf, &value, 1);
+	}
+
+	/// Reads back what append() wrote
+	struct Cursor {
+		const char *p;
+
+		template <typename T>
+		void take(T *values, size_t n)
+		{
+			memcpy(values, p, n * sizeof(T));
+			p += n * sizeof(T);
+		}
+
+		template <typename T>
+		T take()
+		{
+			T value;
+			take(&value, 1);
+			return value;
+		}
+	};
+
+	void writeAll(int fd, const char *data, size_t size, uint64_t offset, const string &path)
+	{
+		while(size > 0) {
+			const ssize_t n = pwrite(fd, data, size, offset);
+			if(n < 0) {
+				if(errno == EINTR) continue;
+				throw ioError("Couldn't write", path);
+			}
+			data += n;
+			size -= n;
+			offset += n;
+		}
+	}
+
+	void readAll(int fd, char *data, size_t size, uint64_t offset, const string &path)
+	{
+		while(size > 0) {
+			const ssize_t n = pread(fd, data, size, offset);
+			if(n < 0 && errno == EINTR) continue;
+			if(n <= 0) throw ioError("Couldn't read", path);
+			data += n;
+			size -= n;
+			offset += n;
+		}
+	}
+}
+
+NetStore::NetStore(const std::string &prefix, std::size_t netCount)
+: dataPath(prefix + ".nets")
+, indexPath(prefix + ".index")
+, count(netCount)
+{
+	dataFile = open(dataPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(dataFile < 0) {
+		throw ioError("Couldn't create", dataPath);
+	}
+
+	// The destructor won't run if this throws
+	auto fail = [&](const string &what, const string &path) {
+		const runtime_error error = ioError(what, path);
+		close(dataFile);
+		unlink(dataPath.c_str());
+		unlink(indexPath.c_str());
+		return error;
+	};
+
+	const int indexFile = open(indexPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(indexFile < 0) {
+		throw fail("Couldn't create", indexPath);
+	}
+
+	// A fresh file reads as zeros, so every slot starts out empty
+	const size_t bytes = max<size_t>(1, count) * sizeof(Slot);
+	if(ftruncate(indexFile, bytes) != 0) {
+		const runtime_error error = fail("Couldn't size", indexPath);
+		close(indexFile);
+		throw error;
+	}
+	void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, indexFile, 0);
+	close(indexFile);
+	if(p == MAP_FAILED) {
+		throw fail("Couldn't map", indexPath);
+	}
+	index = static_cast<Slot *>(p);
+}
+
+NetStore::~NetStore()
+{
+	if(index) munmap(index, max<size_t>(1, count) * sizeof(Slot));
+	if(dataFile >= 0) close(dataFile);
+	unlink(dataPath.c_str());
+	unlink(indexPath.c_str());
+}
+
+void NetStore::put(const Net &n)
+{
+	if(n.id < 0 || size_t(n.id) >= count) {
+		throw runtime_error("Net n" + to_string(n.id) + " is out of range for the net store");
+	}
+
+	buffer.clear();
+	append(buffer, uint64_t(n.pins.size()));
+	append(buffer, n.pins.data(), n.pins.size());
+	append(buffer, uint64_t(n.nroute.size()));
+	for(const auto &path : n.nroute) {
+		append(buffer, path.p1);
+		append(buffer, path.p2);
+		append(buffer, uint64_t(path.edges.size()));
+		append(buffer, path.edges.data(), path.edges.size());
+	}
+
+	writeAll(dataFile, buffer.data(), buffer.size(), end, dataPath);
+
+	Slot &slot = index[n.id];
+	live += buffer.size() - slot.size;
+	slot = Slot{end, buffer.size()};
+	end += buffer.size();
+}
+
+void NetStore::get(int id, Net &n) const
+{
+	const Slot &slot = index[id];
+	if(slot.size == 0) {
+		throw runtime_error("Net n" + to_string(id) + " isn't in the net store");
+	}
+
+	buffer.resize(slot.size);
+	readAll(dataFile, buffer.data(), slot.size, slot.offset, dataPath);
+	Cursor in{buffer.data()};
+
+	n.id = id;
+	n.pins.resize(in.take<uint64_t>());
+	in.take(n.pins.data(), n.pins.size());
+
+	n.nroute.resize(in.take<uint64_t>());
+	for(auto &path : n.nroute) {
+		path.p1 = in.take<Point>();
+		path.p2 = in.take<Point>();
+		path.edges.resize(in.take<uint64_t>());
+		in.take(path.edges.data(), path.edges.size());
+	}
+}
+
+void NetStore::compact()
+{
+	const string tmpPath = dataPath + ".tmp";
+	const int tmp = open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(tmp < 0) {
+		throw ioError("Couldn't create", tmpPath);
+	}
+
+	// Copy the latest records in ID order, then point the index at the
+	// copies, so a failure partway leaves the store as it was
+	uint64_t offset = 0;
+	try {
+		for(size_t id = 0; id < count; ++id) {
+			const Slot &slot = index[id];
+			if(slot.size == 0) continue;
+
+			buffer.resize(slot.size);
+			readAll(dataFile, buffer.data(), slot.size, slot.offset, dataPath);
+			writeAll(tmp, buffer.data(), slot.size, offset, tmpPath);
+			offset += slot.size;
+		}
+	}
+	catch(...) {
+		close(tmp);
+		unlink(tmpPath.c_str());
+		throw;
+	}
+
+	if(rename(tmpPath.c_str(), dataPath.c_str()) != 0) {
+		close(tmp);
+		throw ioError("Couldn't replace", dataPath);
+	}
+	close(dataFile);
+	dataFile = tmp;
+
+	offset = 0;
+	for(size_t id = 0; id < count; ++id) {
+		Slot &slot = index[id];
+		if(slot.size == 0) continue;
+		slot.offset = offset;
+		offset += slot.size;
+	}
+	end = offset;
+	live = offset;
+}
@@ -0,0 +1,64 @@
+/// \file
+#ifndef NETSTORE_HPP_B6QW1N
+#define NETSTORE_HPP_B6QW1N
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ece556.hpp"
+
+/// Pins and routes of nets kept on disk rather than in memory, for
+/// instances whose nets don't fit (see RoutingSolver::rrrOutOfCore).
+///
+/// Each net is serialized into one record appended to `prefix.nets`;
+/// storing a net again appends a new record and leaves the old one as
+/// garbage until compact() rewrites the file. Where each net's latest
+/// record is lives in `prefix.index`, an array of (offset, size) by net ID
+/// that is mapped into memory, so the operating system pages it in and out
+/// like the records themselves. Both files are scratch space, removed when
+/// the store is destroyed. Throws std::runtime_error on I/O errors.
+class NetStore {
+public:
+	/// Create the files for nets with IDs 0 to netCount-1, replacing any
+	/// already there
+	NetStore(const std::string &prefix, std::size_t netCount);
+	~NetStore();
+
+	NetStore(const NetStore &) = delete;
+	NetStore &operator=(const NetStore &) = delete;
+
+	std::size_t size() const { return count; }
+
+	/// Whether net id has been stored
+	bool contains(int id) const { return index[id].size > 0; }
+
+	/// Store n (pins and route), replacing what was stored for n.id
+	void put(const Net &n);
+
+	/// Load net id into n, reusing its storage
+	void get(int id, Net &n) const;
+
+	/// Bytes of records that have been replaced since the last compact()
+	std::uint64_t garbage() const { return end - live; }
+	std::uint64_t liveBytes() const { return live; }
+
+	/// Rewrite the records file with only the latest record of each net
+	void compact();
+
+private:
+	struct Slot {
+		std::uint64_t offset;
+		std::uint64_t size; ///< 0 if the net hasn't been stored
+	};
+
+	std::string dataPath, indexPath;
+	int dataFile = -1;
+	Slot *index = nullptr;  ///< mapped from indexPath, by net ID
+	std::size_t count;
+	std::uint64_t end = 0;  ///< size of the records file
+	std::uint64_t live = 0; ///< bytes of the latest records
+	mutable std::vector<char> buffer;
+};
+
+#endif // NETSTORE_HPP_B6QW1N
@@ -0,0 +1,59 @@
+#include "Pipeline.hpp"
+
+#include <exception>
+#include <future>
+
+#include "BoundedQueue.hpp"
+
+using namespace std;
+
+void solveRoutingPipelined(MappedReader &reader, RoutingInst &inst, RoutingSolver &rst, NetStore *spill)
+{
+	BoundedQueue<Net> parsed(pipelineQueueSize), decomposed(pipelineQueueSize);
+	const size_t netCount = spill ? spill->size() : inst.nets.size();
+	const bool useNetDecomposition = rst.useNetDecomposition;
+
+	// The router only reads the capacity overrides after this thread is done
+	auto parser = async(launch::async, [&] {
+		try {
+			for(size_t i = 0; i < netCount; ++i) {
+				Net n;
+				reader.readNet(n);
+				if(!parsed.push(std::move(n))) return; // the router gave up
+			}
+			parsed.close();
+			reader.readTrailer(inst);
+		}
+		catch(...) {
+			parsed.close();
+			throw;
+		}
+	});
+
+	auto decomposer = async(launch::async, [&] {
+		Net n;
+		while(parsed.pop(n)) {
+			decomposeNet(n, useNetDecomposition);
+			if(!decomposed.push(std::move(n))) break;
+		}
+		decomposed.close();
+	});
+
+	exception_ptr routingError;
+	try {
+		rst.solveRoutingStreamed(decomposed, spill);
+	}
+	catch(...) {
+		routingError = current_exception();
+		decomposed.close();
+		parsed.close();
+	}
+
+	decomposer.get();
+	parser.get();
+	if(routingError) {
+		rethrow_exception(routingError);
+	}
+
+	rst.applyCapacityOverrides();
+}
@@ -0,0 +1,32 @@
+/// \file
+#ifndef PIPELINE_HPP_M5XG2R
+#define PIPELINE_HPP_M5XG2R
+
+#include <cstddef>
+#include "NetStore.hpp"
+#include "RoutingInst.hpp"
+#include "RoutingSolver.hpp"
+#include "mappedreader.hpp"
+
+/// Nets each pipeline queue holds at most
+const std::size_t pipelineQueueSize = 4096;
+
+/// Read the nets and then the capacity overrides from reader into inst, and
+/// build rst's initial solution on the way, in three stages with bounded
+/// queues between them: one thread parses nets, another decomposes them
+/// and the calling thread routes each as soon as it is decomposed.
+///
+/// reader must be just past the header, inst must hold the header's grid
+/// and N placeholder nets with IDs 0 to N-1, and rst must be made over inst.
+/// Capacity overrides come after the nets in the input, so the initial
+/// routes are found with the default capacity everywhere and rip-up and
+/// reroute has to deal with blockages. Nets are routed in input order.
+///
+/// With spill, routed nets go into it instead and inst holds no nets; the
+/// net count is the store's size.
+///
+/// Parse errors are rethrown in preference to the routing errors they cause.
+void solveRoutingPipelined(MappedReader &reader, RoutingInst &inst, RoutingSolver &rst,
+                           NetStore *spill = nullptr);
+
+#endif // PIPELINE_HPP_M5XG2R
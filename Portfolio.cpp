@@ -0,0 +1,131 @@
+#include "Portfolio.hpp"
+
+#include <future>
+#include <iostream>
+#include <mutex>
+
+#include "InterruptGuard.hpp"
+#include "RoutingSolver.hpp"
+
+using namespace std;
+
+namespace
+{
+	/// RRR iterations every configuration gets before it can be cut off,
+	/// as initial solutions say little about where RRR takes them
+	const int graceIterations = 2;
+
+	/// The best solution each configuration has reported so far, shared by
+	/// the threads running them
+	class Scoreboard {
+	public:
+		Scoreboard(const vector<Options::PortfolioEntry> &entries, double cutoff)
+		: entries(entries)
+		, best(entries.size())
+		, reported(entries.size(), false)
+		, cutoff(cutoff)
+		{ }
+
+		/// Record the best solution of configuration i after RRR iteration
+		/// iter. Returns false if it has fallen too far behind to continue.
+		bool report(size_t i, int iter, const ConvergenceMonitor::Sample &sample)
+		{
+			lock_guard<mutex> lock(m);
+			best[i] = sample;
+			reported[i] = true;
+
+			cout << entries[i].name << ": iteration " << iter << ", best total overflow "
+			     << sample.overflow << ", wirelength " << sample.wirelength << "\n";
+
+			size_t leader = i;
+			for(size_t j = 0; j < best.size(); ++j) {
+				if(reported[j] && ConvergenceMonitor::better(best[j], best[leader])) leader = j;
+			}
+			if(leader == i || iter < graceIterations) return true;
+
+			const auto &lead = best[leader];
+			const bool behind = lead.overflow > 0
+				? sample.overflow > lead.overflow * (1 + cutoff)
+				: sample.overflow > 0 || sample.wirelength > lead.wirelength * (1 + cutoff);
+			if(behind) {
+				cout << entries[i].name << ": cut off, trailing " << entries[leader].name << "\n";
+			}
+			return !behind;
+		}
+
+	private:
+		const vector<Options::PortfolioEntry> &entries;
+		vector<ConvergenceMonitor::Sample> best;
+		vector<bool> reported;
+		double cutoff;
+		mutex m;
+	};
+
+	struct Result {
+		vector<Net> nets;
+		EdgeState::Totals totals;
+	};
+
+	Result runEntry(const RoutingInst &inst, Options opts, const Options::PortfolioEntry &entry,
+	                chrono::steady_clock::time_point deadline, const function<bool(int, const ConvergenceMonitor::Sample &)> &keepGoing)
+	{
+		opts.costFunction = entry.costFunction;
+		opts.useNetDecomposition = entry.useNetDecomposition;
+		opts.useNetOrdering = entry.useNetOrdering;
+		opts.emitSVG = false; // every configuration would write the same log
+
+		Result result;
+		result.nets = inst.nets;
+
+		ostream quiet(nullptr); // progress of concurrent solvers would be unreadable
+		RoutingSolver rst(inst, result.nets);
+		rst.applyOptions(opts);
+		rst.deadline = deadline;
+		rst.console = &quiet;
+		rst.keepGoing = keepGoing;
+
+		if(opts.useNetOrdering)
+			rst.reorderNets(result.nets);
+		rst.solveRouting();
+		if(opts.useNetOrdering || opts.useNetDecomposition)
+			rst.rrr();
+
+		result.totals = rst.totals();
+		return result;
+	}
+}
+
+std::vector<Net> runPortfolio(const RoutingInst &inst, const Options &opts,
+                              std::chrono::steady_clock::time_point deadline)
+{
+	const auto &entries = opts.portfolio;
+	Scoreboard scores(entries, opts.portfolioCutoff);
+
+	cout << "Racing " << entries.size() << " configurations\n";
+
+	// One handler for all of them; each solver only polls the flag
+	InterruptGuard interruptible;
+
+	vector<future<Result>> futures;
+	for(size_t i = 0; i < entries.size(); ++i) {
+		auto keepGoing = [&scores, i](int iter, const ConvergenceMonitor::Sample &best) {
+			return scores.report(i, iter, best);
+		};
+		futures.push_back(async(launch::async, runEntry, cref(inst), opts, cref(entries[i]), deadline, keepGoing));
+	}
+
+	vector<Result> results;
+	for(auto &f : futures) results.push_back(f.get());
+
+	size_t winner = 0;
+	for(size_t i = 0; i < results.size(); ++i) {
+		const auto &t = results[i].totals;
+		cout << entries[i].name << ": final total overflow " << t.overflow << ", wirelength " << t.util << "\n";
+
+		const auto &w = results[winner].totals;
+		if(ConvergenceMonitor::better({t.overflow, t.util, 0}, {w.overflow, w.util, 0})) winner = i;
+	}
+	cout << "Writing the solution of " << entries[winner].name << "\n";
+
+	return std::move(results[winner].nets);
+}
@@ -0,0 +1,23 @@
+/// \file
+#ifndef PORTFOLIO_HPP_R3KX8M
+#define PORTFOLIO_HPP_R3KX8M
+
+#include <chrono>
+#include <vector>
+#include "RoutingInst.hpp"
+#include "options.hpp"
+
+/// Route inst with every configuration in opts.portfolio at once, each on
+/// its own thread, and return the nets (with routes) of the one that ends
+/// with the least total overflow, then wirelength.
+///
+/// The configurations share inst and each routes its own copy of the nets.
+/// Every RRR iteration, a configuration compares the best solution it has
+/// found with the leader's, and stops once it trails by more than
+/// opts.portfolioCutoff, so the time goes to the configurations that are
+/// still in the running. All of them stop by the deadline, or once ^C is
+/// pressed.
+std::vector<Net> runPortfolio(const RoutingInst &inst, const Options &opts,
+                              std::chrono::steady_clock::time_point deadline);
+
+#endif // PORTFOLIO_HPP_R3KX8M
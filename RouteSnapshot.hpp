@@ -0,0 +1,50 @@
+/// \file
+#ifndef ROUTESNAPSHOT_HPP_C6JD1Y
+#define ROUTESNAPSHOT_HPP_C6JD1Y
+
+#include <vector>
+#include "ece556.hpp"
+
+/// The routes of every net as they were at some point, kept up to date
+/// incrementally.
+///
+/// The router bumps a per-net version number (indexed by net ID) whenever it
+/// changes a net's route. capture() only copies the routes of nets whose
+/// version differs from the one captured last time, so keeping a snapshot of
+/// the best solution costs time proportional to the nets rerouted since,
+/// not to the size of the design.
+class RouteSnapshot {
+public:
+	/// Bring the snapshot up to date with nets
+	void capture(const std::vector<Net> &nets, const std::vector<unsigned> &versions)
+	{
+		if(routes.size() < versions.size()) {
+			routes.resize(versions.size());
+			captured.resize(versions.size(), ~0u); // matches no version yet
+		}
+
+		for(const auto &net : nets) {
+			if(captured[net.id] != versions[net.id]) {
+				routes[net.id] = net.nroute;
+				captured[net.id] = versions[net.id];
+			}
+		}
+	}
+
+	bool empty() const { return routes.empty(); }
+
+	/// Whether the net with the given ID still has its captured route
+	bool isCurrent(int id, const std::vector<unsigned> &versions) const
+	{
+		return captured[id] == versions[id];
+	}
+
+	const Route &route(int id) const { return routes[id]; }
+	unsigned version(int id) const { return captured[id]; }
+
+private:
+	std::vector<Route> routes;     ///< by net ID
+	std::vector<unsigned> captured; ///< version of each route in routes
+};
+
+#endif // ROUTESNAPSHOT_HPP_C6JD1Y
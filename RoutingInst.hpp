@@ -2,26 +2,67 @@
 #ifndef ROUTINGINST_HPP_OP8EQ1
 #define ROUTINGINST_HPP_OP8EQ1
 
+#include <algorithm>
 #include <vector>
 #include "ece556.hpp"
+#include "CapacityMap.hpp"
+#include "GridGeometry.hpp"
 
 
 struct RoutingInst {
 	int gx, gy;
-	int cap;
-	std::vector<int> edgeCaps;
+	int cap; ///< default capacity of every edge
+	CapacityMap edgeCaps; ///< capacities of edges that differ from cap because of blockages
 	std::vector<Net> nets;
+	GridGeometry::Layout layout = GridGeometry::RowMajor; ///< how edges are numbered
+
+	/// The MST decomposition (decomposeNetMST) of every net by ID, with
+	/// unrouted paths, if one was precomputed; otherwise empty
+	std::vector<Route> decomposition;
+
+	/// Renumber edges in the given layout, translating every edge ID already
+	/// stored in the capacity overrides and the nets' routes
+	void setLayout(GridGeometry::Layout newLayout)
+	{
+		const GridGeometry from = geometry();
+		layout = newLayout;
+		const GridGeometry to = geometry();
+
+		auto remap = [&](int id) { return to.edgeID(from.edge(id)); };
+
+		edgeCaps.remapIDs(remap);
+		for(auto &net : nets) {
+			for(auto &path : net.nroute) {
+				for(int &id : path.edges) id = remap(id);
+			}
+		}
+	}
 
 
 	void setEdgeCap(const Point &p1, const Point &p2, int capacity)
 	{
-		int id = edgeID(p1, p2);
-		getElementResizingIfNecessary(edgeCaps, id, cap) = capacity;
+		edgeCaps.set(edgeID(p1, p2), capacity);
+	}
+
+	/// Largest capacity of any edge
+	int maxCap() const
+	{
+		return std::max(cap, edgeCaps.maxValue());
+	}
+
+	GridGeometry geometry() const
+	{
+		return GridGeometry(gx, gy, layout);
+	}
+
+	int numEdges() const
+	{
+		return geometry().numEdges();
 	}
 
 	int edgeID(const Point &p1, const Point &p2) const
 	{
-		return ::edgeID(gx, gy, p1.x, p1.y, p2.x, p2.y);
+		return geometry().edgeID(p1, p2);
 	}
 
 	int edgeID(const Edge &e) const
@@ -31,12 +72,12 @@ struct RoutingInst {
 
 	Edge edge(int edgeID) const
 	{
-		return ::edge(gx, gy, edgeID);
+		return geometry().edge(edgeID);
 	}
 
 	int edgeCap(const Point &p1, const Point &p2) const
 	{
-		return getElementOrDefault(edgeCaps, edgeID(p1, p2), cap);
+		return edgeCaps.get(edgeID(p1, p2), cap);
 	}
 
 };
@@ -2,6 +2,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <fstream>
@@ -12,7 +15,6 @@
 #include <map>
 #include <unordered_map>
 #include <unordered_set>
-#include <csignal>
 #include <thread>
 #include <future>
 
@@ -20,6 +22,7 @@
 #include "ece556.hpp"
 #include "reader.hpp"
 #include "writer.hpp"
+#include "evaluator.hpp"
 #include "util.hpp"
 #include "PeriodicRunner.hpp"
 #include "progress.hpp"
@@ -28,6 +31,8 @@
 #include "IteratorUtils.hpp"
 
 #include "RoutingSolver.hpp"
+#include "BinaryIO.hpp"
+#include "InterruptGuard.hpp"
 
 using namespace std;
 
@@ -43,34 +48,19 @@ namespace
 
 void RoutingSolver::updateEdgeWeights()
 {
-	edgeInfos.resize(edgeCaps.size());
-
-	for(size_t i = 0; i < edgeInfos.size(); ++i) {
-		auto &ei = edgeInfos[i];
-		const int overflow = edgeUtils[i] - edgeCaps[i];
-
-		if(overflow > 0) {
-			ei.overflowCount++;
-			ei.weight = overflow * ei.overflowCount;
-		}
-		else {
-			ei.weight = 0;
-		}
+	edges.updateWeights();
+	if(costFunction == Options::NC) {
+		ncCosts.rebuild(iteration);
+	}
+	else if(costFunction == Options::PathFinder) {
+		negotiation.nextIteration();
 	}
 }
 
 
 int RoutingSolver::edgeWeight(int id) const
 {
-	size_t index = id;
-
-	if(index < edgeInfos.size()) {
-		return edgeInfos[index].weight;
-	}
-	else {
-		return 0; // initial value
-	}
-	
+	return edges.weight(id);
 }
 
 int RoutingSolver::netSpan(const Net &n) const
@@ -191,6 +181,24 @@ int RoutingSolver::totalEdgeWeight(const Net &n) const
 	return result;
 }
 
+/// Total overflow of the edges n uses
+int RoutingSolver::overflowContribution(const Net &n) const
+{
+	unordered_set<int> counted;
+	int result = 0;
+
+	for(const auto &route : n.nroute) {
+		for(int edgeID : route.edges) {
+			if (counted.count(edgeID) > 0) continue;
+
+			counted.emplace(edgeID);
+			result += max(0, edges.util(edgeID) - edges.cap(edgeID));
+		}
+	}
+
+	return result;
+}
+
 
 bool RoutingSolver::neighbor(Point &p, unsigned int caseNumber)
 {
@@ -214,10 +222,19 @@ bool RoutingSolver::neighbor(Point &p, unsigned int caseNumber)
 bool RoutingSolver::hasViolation(const Net &n) const
 {
 	for(const auto &route : n.nroute) {
-		for(int id : route.edges) {
-			if(edgeUtils[id] > edgeCaps[id]) {
-				return true;
-			}
+		if(hasViolation(route)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool RoutingSolver::hasViolation(const Path &p) const
+{
+	for(int id : p.edges) {
+		if(edges.util(id) > edges.cap(id)) {
+			return true;
 		}
 	}
 
@@ -228,14 +245,18 @@ void RoutingSolver::connectViaLine(std::vector<int>& s, Point p1, Point p2) {
 	if (p1.x == p2.x) {
 		Point p = Point{p1.x, std::min<int>(p1.y, p2.y)};
 		int end = std::max<int>(p1.y, p2.y);
+		auto cell = grid.cellEdges(p);
 		for (; p.y < end; p.y++) {
-			s.push_back(edgeID(Edge::vertical(p)));
+			s.push_back(cell.north);
+			cell = grid.step(cell, GridGeometry::North);
 		}
 	} else if (p1.y == p2.y) {
 		Point p = Point{std::min<int>(p1.x, p2.x), p1.y};
 		int end = std::max<int>(p1.x, p2.x);
+		auto cell = grid.cellEdges(p);
 		for (; p.x < end; p.x++) {
-			s.push_back(edgeID(Edge::horizontal(p)));
+			s.push_back(cell.east);
+			cell = grid.step(cell, GridGeometry::East);
 		}
 	} else {
 		assert (0 == 1);
@@ -255,13 +276,11 @@ void RoutingSolver::ellRouteSeg(Path& s)
 	connectViaLine(yxr, s.p2, Point{s.p2.x, s.p1.y});
 
 	for (const auto e : xyr) {
-		xyv += 1 + penalty*getElementOrDefault(edgeUtils, e, 0) /
-			(getElementOrDefault(edgeCaps, e, cap) + 1);
+		xyv += 1 + penalty*edges.util(e) / (edges.cap(e) + 1);
 	}
 
 	for (const auto e : yxr) {
-		yxv += 1 + penalty*getElementOrDefault(edgeUtils, e, 0) /
-			(getElementOrDefault(edgeCaps, e, cap) + 1);
+		yxv += 1 + penalty*edges.util(e) / (edges.cap(e) + 1);
 	}
 
 	if (yxv < xyv) {
@@ -273,9 +292,63 @@ void RoutingSolver::ellRouteSeg(Path& s)
 
 void RoutingSolver::aStarRouteSeg(Path& s)
 {
+	switch(edges.bits()) {
+		case 8: aStarRouteSeg(s, edges.fields<uint8_t>()); break;
+		case 16: aStarRouteSeg(s, edges.fields<uint16_t>()); break;
+		default: aStarRouteSeg(s, edges.fields<int>()); break;
+	}
+}
+
+template <typename T>
+void RoutingSolver::aStarRouteSeg(Path& s, const EdgeState::Fields<T> &fields)
+{
+	const SearchWindow grid{0, 0, gx - 1, gy - 1};
+
+	switch(costFunction) {
+		case Options::Standard: {
+			aStarRouteSeg(s, StandardCost<T>{fields, penalty}, grid);
+		} break;
+		case Options::NC: {
+			aStarRouteSeg(s, NCCost<T>{fields, ncCosts}, grid);
+		} break;
+		case Options::PathFinder: {
+			aStarRouteSeg(s, PathFinderCost<T>{fields, negotiation}, grid);
+		} break;
+	}
+}
+
+bool RoutingSolver::detourSeg(Path& s, const SearchWindow &window, const unordered_map<int, int> &ownEdges)
+{
+	switch(edges.bits()) {
+		case 8: return detourSeg(s, window, ownEdges, edges.fields<uint8_t>());
+		case 16: return detourSeg(s, window, ownEdges, edges.fields<uint16_t>());
+		default: return detourSeg(s, window, ownEdges, edges.fields<int>());
+	}
+}
+
+template <typename T>
+bool RoutingSolver::detourSeg(Path& s, const SearchWindow &window, const unordered_map<int, int> &ownEdges,
+                              const EdgeState::Fields<T> &fields)
+{
+	switch(costFunction) {
+		case Options::Standard:
+			return aStarRouteSeg(s, spareCapacityOnly(StandardCost<T>{fields, penalty}, fields, ownEdges), window);
+		case Options::NC:
+			return aStarRouteSeg(s, spareCapacityOnly(NCCost<T>{fields, ncCosts}, fields, ownEdges), window);
+		case Options::PathFinder:
+			return aStarRouteSeg(s, spareCapacityOnly(PathFinderCost<T>{fields, negotiation}, fields, ownEdges), window);
+	}
+	return false;
+}
+
+template <typename CostPolicy>
+bool RoutingSolver::aStarRouteSeg(Path& s, const CostPolicy &edgeCost, const SearchWindow &window)
+{
+	typedef typename CostPolicy::Cost Cost;
+
 	unordered_set<Point> open;
 	unordered_set<Point> closed;
-	typedef std::pair<double, Point> CostPoint;
+	typedef std::pair<Cost, Point> CostPoint;
 	
 	auto costComp = [&](const CostPoint &p1, const CostPoint &p2) {
 		return p1.first + s.p2.l1dist(p1.second) >
@@ -286,7 +359,7 @@ void RoutingSolver::aStarRouteSeg(Path& s)
 	unordered_map<Point, Point> prev;
 
 	Point p0;
-	double p0_cost;
+	Cost p0_cost;
 
 	assert(s.edges.empty());
 
@@ -303,31 +376,25 @@ void RoutingSolver::aStarRouteSeg(Path& s)
 		open.erase(p0);
 		closed.emplace(p0);
 
+		const auto cell = grid.cellEdges(p0);
 		
 		// add valid neighbors
 		for(unsigned int neighborCase = 0; neighborCase < 4; ++neighborCase) {
 			Point p = p0;
-			if(!neighbor(p, neighborCase)) continue;
+			if(!neighbor(p, neighborCase) || !window.contains(p)) continue;
 
 			// skip previously/currently examined
 			if (closed.count(p) > 0 || open.count(p) > 0) {
 				continue;
 			}
 			
-			double extraCost;
-			if(costFunction == Options::NC) {
-				double h = min(1.0, 0.5 + iteration / 100.0);
-				double k = min(1.0, 0.01 + iteration / 100.0);
-				auto &ei = getElementResizingIfNecessary(edgeInfos, edgeID(p, p0), {});
-				extraCost = 1 + h / (1.0 + exp(-k * (edgeUtil(p, p0) + ei.weight) / edgeCap(p, p0))) - h;
-			}
-			else {
-				extraCost = 1 + penalty * edgeUtil(p, p0) / (edgeCap(p, p0) + 1);
-			}
+			const int id = grid.edgeToward(cell, GridGeometry::Direction(neighborCase));
+			if(!edgeCost.usable(id)) continue;
+
 			// queue valid neighbors for future examination
 			open.emplace(p);
 			open_score.emplace(
-				p0_cost + extraCost,
+				p0_cost + edgeCost(id),
 // 				p0_cost + 1 +
 // 				penalty*edgeUtil(p, p0) / (edgeCap(p, p0)+1),
 				p);
@@ -335,11 +402,14 @@ void RoutingSolver::aStarRouteSeg(Path& s)
 		}
 	}
 
+	if(closed.count(s.p2) == 0) return false;
+
 	// Walk backwards to create route
 	for (Point p = s.p2; p != s.p1; p = prev[p]) {
 		s.edges.emplace_back(edgeID(p, prev[p]));
 	}
 	
+	return true;
 }
 
 void decomposeNets(std::vector<Net>& nets, bool useNetDecomposition)
@@ -446,6 +516,16 @@ void decomposeNet(Net& n, bool useNetDecomposition)
 	}
 }
 
+void RoutingSolver::decomposeAll()
+{
+	if(useNetDecomposition && inst.decomposition.size() == nets.size()) {
+		for(auto &n : nets) n.nroute = inst.decomposition[n.id];
+	}
+	else {
+		decomposeNets(nets, useNetDecomposition);
+	}
+}
+
 // route an unrouted net
 void RoutingSolver::routeNet(Net& n)
 {
@@ -456,22 +536,29 @@ void RoutingSolver::routeNet(Net& n)
 void RoutingSolver::placeNet(const Net& n)
 {
 	unordered_set<int> placed;
+	int busiest = 0;
 
-	for (const auto s : n.nroute) {
+	for (const auto &s : n.nroute) {
 		for (const auto edge : s.edges) {
-			if (placed.count(edge) > 0) {
-				continue;
+			if (placed.emplace(edge).second) {
+				busiest = max(busiest, edges.util(edge));
 			}
+		}
+	}
 
-			if (findDependencyChains) {
-				auto &ei = getElementResizingIfNecessary(edgeInfos, edge, EdgeInfo{});
-				ei.nets.insert(n.id);
-			}
+	// Widen the edge state here, between searches, if the net doesn't fit
+	edges.widenFor(busiest + 1);
 
-			getElementResizingIfNecessary(edgeUtils, edge, 0)++;
-			placed.emplace(edge);
+	for (const auto edge : placed) {
+		if (findDependencyChains) {
+			auto &ei = getElementResizingIfNecessary(edgeInfos, edge, EdgeInfo{});
+			ei.nets.insert(n.id);
 		}
+
+		edges.addUtil(edge, 1);
 	}
+
+	assert(routeValid(n.nroute, true));
 }
 
 // rip up the route from an old net and return it
@@ -490,23 +577,192 @@ void RoutingSolver::ripNet(Net& n)
 				ei.nets.erase(n.id);
 			}
 
-			getElementResizingIfNecessary(edgeUtils, edge, 0)--;
+			edges.addUtil(edge, -1);
 			ripped.emplace(edge);
 		}
 	}
 	n.nroute.clear();
+	routeChanged(n);
+}
+
+void RoutingSolver::releaseEdge(Net& n, int id, unordered_map<int, int>& pathsUsing)
+{
+	if(--pathsUsing[id] > 0) return;
+
+	if(findDependencyChains) {
+		getElementResizingIfNecessary(edgeInfos, id, EdgeInfo{}).nets.erase(n.id);
+	}
+	edges.addUtil(id, -1);
+}
+
+void RoutingSolver::claimEdge(Net& n, int id, unordered_map<int, int>& pathsUsing)
+{
+	if(pathsUsing[id]++ > 0) return;
+
+	if(findDependencyChains) {
+		getElementResizingIfNecessary(edgeInfos, id, EdgeInfo{}).nets.insert(n.id);
+	}
+	edges.widenFor(edges.util(id) + 1);
+	edges.addUtil(id, 1);
+}
+
+int RoutingSolver::reroutePathsWithViolation(Net& n)
+{
+	// A net adds one to the utilization of an edge however many of its paths
+	// use it, so count the paths on each edge and only touch the utilization
+	// when that count drops to or rises from zero. Paths are simple, so no
+	// edge appears twice within one path.
+	unordered_map<int, int> pathsUsing;
+	vector<Path *> ripped;
+	int repaired = 0;
+
+	for(const auto &path : n.nroute) {
+		for(int id : path.edges) {
+			++pathsUsing[id];
+		}
+	}
+
+	for(auto &path : n.nroute) {
+		if(!hasViolation(path)) continue;
+
+		if(ripupMode == Options::RepairPaths && repairPath(n, path, pathsUsing)) {
+			++repaired;
+		}
+		else {
+			ripped.push_back(&path);
+		}
+	}
+
+	for(Path *path : ripped) {
+		for(int id : path->edges) {
+			releaseEdge(n, id, pathsUsing);
+		}
+		path->edges.clear();
+	}
+
+	parallelForEach(ripped.begin(), ripped.end(), 
+	                [&](Path *path) { aStarRouteSeg(*path); });
+
+	for(Path *path : ripped) {
+		for(int id : path->edges) {
+			claimEdge(n, id, pathsUsing);
+		}
+	}
+
+	if(!ripped.empty() || repaired > 0) {
+		routeChanged(n);
+	}
+	return ripped.size() + repaired;
+}
+
+bool RoutingSolver::repairPath(Net& n, Path& path, unordered_map<int, int>& pathsUsing)
+{
+	++repairStats.attempted;
+
+	// Walk the path from p1 to p2 to put its edges in order
+	unordered_map<Point, vector<int>> incident;
+	for(int id : path.edges) {
+		const Edge e = edge(id);
+		incident[e.p1].push_back(id);
+		incident[e.p2].push_back(id);
+	}
+
+	vector<int> walk;
+	vector<Point> points{path.p1};
+	int previous = -1;
+	while(points.back() != path.p2 && walk.size() < path.edges.size()) {
+		const auto it = incident.find(points.back());
+		if(it == incident.end() || it->second.size() > 2) return false;
+
+		const auto &ids = it->second;
+		const int next = ids[0] != previous ? ids[0] : ids.size() > 1 ? ids[1] : -1;
+		if(next < 0) return false;
+
+		const Edge e = edge(next);
+		points.push_back(e.p1 == points.back() ? e.p2 : e.p1);
+		walk.push_back(next);
+		previous = next;
+	}
+	if(points.back() != path.p2 || walk.size() != path.edges.size()) return false;
+
+	// The stretch to replace runs from the first to the last overflowed edge
+	size_t first = walk.size(), last = 0;
+	for(size_t k = 0; k < walk.size(); ++k) {
+		if(edges.util(walk[k]) > edges.cap(walk[k])) {
+			first = min(first, k);
+			last = k;
+		}
+	}
+	if(first == walk.size()) return false;
+
+	SearchWindow window{gx - 1, gy - 1, 0, 0};
+	for(size_t k = first; k <= last + 1; ++k) {
+		window.xmin = min(window.xmin, points[k].x);
+		window.ymin = min(window.ymin, points[k].y);
+		window.xmax = max(window.xmax, points[k].x);
+		window.ymax = max(window.ymax, points[k].y);
+	}
+	window.xmin = max(0, window.xmin - repairMargin);
+	window.ymin = max(0, window.ymin - repairMargin);
+	window.xmax = min(gx - 1, window.xmax + repairMargin);
+	window.ymax = min(gy - 1, window.ymax + repairMargin);
+
+	for(size_t k = first; k <= last; ++k) {
+		releaseEdge(n, walk[k], pathsUsing);
+	}
+
+	Path detour(points[first], points[last + 1]);
+	bool ok = detourSeg(detour, window, pathsUsing);
+
+	// The detour must not touch the kept parts of the path anywhere but at
+	// its ends, which would make the path loop
+	unordered_set<Point> kept(points.begin(), points.begin() + first);
+	kept.insert(points.begin() + last + 2, points.end());
+
+	for(int id : detour.edges) {
+		const Edge e = edge(id);
+		ok = ok && kept.count(e.p1) == 0 && kept.count(e.p2) == 0;
+	}
+
+	if(!ok) {
+		for(size_t k = first; k <= last; ++k) {
+			claimEdge(n, walk[k], pathsUsing);
+		}
+		return false;
+	}
+
+	for(int id : detour.edges) {
+		claimEdge(n, id, pathsUsing);
+	}
+
+	path.edges.assign(walk.begin(), walk.begin() + first);
+	path.edges.insert(path.edges.end(), detour.edges.begin(), detour.edges.end());
+	path.edges.insert(path.edges.end(), walk.begin() + last + 1, walk.end());
+
+	++repairStats.repaired;
+	return true;
 }
 
 int RoutingSolver::countViolations()
 {
-	int v = 0;
-	for (unsigned int i = 0; i < edgeUtils.size(); i++) {
-		if (edgeUtils[i] > edgeCaps[i]) {
-			v++;
+	return edges.countViolations();
+}
+
+bool RoutingSolver::routeValid(const Route& r, bool isplaced) const
+{
+	for (const auto &path : r) {
+		for (const int id : path.edges) {
+			if (!grid.isEdge(id) || (isplaced && edges.util(id) <= 0)) {
+				return false;
+			}
+		}
+
+		if (!connectsAll(grid, path.edges, {path.p1, path.p2})) {
+			return false;
 		}
 	}
 
-	return v;
+	return true;
 }
 
 
@@ -520,15 +776,12 @@ void RoutingSolver::violationSvg(const std::string& fileName)
 	svg << "\twidth=\"" << gx*3 << "\" height=\"" << gy*3 << "\"";
 	svg << ">\n";
 
-	int maxOverflow = 0;
-	for(size_t i = 0; i < edgeCaps.size(); ++i) {
-		maxOverflow = max(maxOverflow, getElementOrDefault(edgeUtils, i, 0) - edgeCaps[i]);
-	}
+	const int maxOverflow = edges.maxOverflow();
 	
-	for (unsigned int i = 0; i < edgeUtils.size(); i++) {
-		e = edge(i);
-		int overflow = edgeUtil(e.p1, e.p2) - edgeCap(e.p1, e.p2);
+	for (int i = 0; i < grid.idSpace(); i++) {
+		int overflow = edges.util(i) - edges.cap(i);
 		if (overflow > 0) {
+			e = edge(i);
 			svg << "\t<path stroke-width=\"3\" d=\"";
 			svg << " M" << e.p1.x*3 << "," << e.p1.y*3;
 			svg << " L" << e.p2.x*3 << "," << e.p2.y*3;
@@ -588,7 +841,7 @@ void RoutingSolver::reorderNetsFancy(std::vector<Net>& nets)
 	
 	auto edgeComp = [&](const int e1, const int e2) {
 		//return edgeInfos[e1].nets.size() < edgeInfos[e2].nets.size();
-		return edgeUtils[e1] * (edgeCaps[e2] + 1) < edgeUtils[e2] * (edgeCaps[e1] + 1);
+		return edges.util(e1) * (edges.cap(e2) + 1) < edges.util(e2) * (edges.cap(e1) + 1);
 	};
 
 	// find ~1000 nets on the worst edges
@@ -694,18 +947,17 @@ void RoutingSolver::reorderNetsFancy(std::vector<Net>& nets)
 	} cl (*this, worst_nets);
 }
 
-chrono::time_point<chrono::steady_clock> procedureStartTime;
 
 void RoutingSolver::solveRouting()
 {
-	cout << "[1/2] Creating initial solution...\n";
+	*console << "[1/2] Creating initial solution...\n";
 
 	int startTime = time(0);
 	procedureStartTime = chrono::steady_clock::now();
 
 	/// Print every 200 milliseconds
 	PeriodicRunner<chrono::milliseconds> printer(chrono::milliseconds(200));
-	ProgressBar pbar(cout);
+	ProgressBar pbar(*console);
 	pbar.max = nets.size();
 
 	int netsRouted = 0;
@@ -721,7 +973,7 @@ void RoutingSolver::solveRouting()
 			.writeln(setw(32), "Overflow penalty: ", penalty);
 	};
 
-	decomposeNets(nets, useNetDecomposition);
+	decomposeAll();
 
 	// find an initial solution
 	for (auto &n : nets) {
@@ -735,6 +987,74 @@ void RoutingSolver::solveRouting()
 	logViolationSvg();
 }
 
+void RoutingSolver::solveRoutingStreamed(BoundedQueue<Net> &arrivals, NetStore *spill)
+{
+	*console << "[1/2] Creating initial solution while reading nets...\n";
+
+	int startTime = time(0);
+	procedureStartTime = chrono::steady_clock::now();
+
+	const size_t netCount = spill ? spill->size() : nets.size();
+	PeriodicRunner<chrono::milliseconds> printer(chrono::milliseconds(200));
+	ProgressBar pbar(*console);
+	pbar.max = netCount;
+
+	int netsRouted = 0;
+
+	auto printFunc = [&]()
+	{
+		pbar.value = netsRouted;
+		pbar
+			.draw()
+			.writeln(setw(32), "Nets routed: ", netsRouted, "/", netCount)
+			.writeln(setw(32), "Elapsed time: ", time(0) - startTime, " seconds")
+			.writeln(setw(32), "Overflow penalty: ", penalty);
+	};
+
+	vector<bool> arrived(spill ? 0 : netCount, false);
+	Net n;
+	while(arrivals.pop(n)) {
+		const bool repeated = n.id >= 0 && size_t(n.id) < netCount && (spill ? spill->contains(n.id) : arrived[n.id]);
+		if(n.id < 0 || size_t(n.id) >= netCount || repeated) {
+			throw runtime_error("Net n" + to_string(n.id) + " is out of range or repeated");
+		}
+
+		if(spill) {
+			routeNet(n);
+			placeNet(n);
+			spill->put(n);
+		}
+		else {
+			arrived[n.id] = true;
+			Net &slot = *nets_byid[n.id];
+			slot = std::move(n);
+			routeNet(slot);
+			placeNet(slot);
+			++routeVersions[slot.id];
+		}
+		++netsRouted;
+		printer.runPeriodically(printFunc);
+	}
+	printFunc();
+
+	if(size_t(netsRouted) != netCount) {
+		throw runtime_error("Only " + to_string(netsRouted) + " of " + to_string(netCount) + " nets arrived");
+	}
+}
+
+void RoutingSolver::applyCapacityOverrides()
+{
+	const unsigned bits = EdgeState::bitsFor(inst.maxCap());
+	if(bits > edges.bits()) {
+		edges.setBits(bits);
+	}
+	for(const auto &o : inst.edgeCaps.entries()) {
+		if(grid.isEdge(o.first)) edges.setCap(o.first, o.second);
+	}
+	ncCosts.setCapacities(cap, inst.edgeCaps, numEdges);
+	ncCosts.rebuild(iteration);
+}
+
 void RoutingSolver::logViolationSvg()
 {
 	if(!emitSVG) return;
@@ -787,9 +1107,16 @@ void RoutingSolver::violationTxt(const string &filename)
 	{
 		for(p.x = 0; p.x < gx; ++p.x)
 		{
-			auto horizEdge = Edge::horizontal(p);
-			auto vertEdge = Edge::vertical(p);
-			int ovf = edgeUtil(horizEdge) + edgeUtil(vertEdge) - edgeCap(horizEdge) - edgeCap(vertEdge);
+			// the cell's east and north edges, where the grid has them
+			int ovf = 0;
+			if(p.x < gx - 1) {
+				auto horizEdge = Edge::horizontal(p);
+				ovf += edgeUtil(horizEdge) - edgeCap(horizEdge);
+			}
+			if(p.y < gy - 1) {
+				auto vertEdge = Edge::vertical(p);
+				ovf += edgeUtil(vertEdge) - edgeCap(vertEdge);
+			}
 			txt << ovf << ' ';
 		}
 		txt << '\n';
@@ -797,16 +1124,26 @@ void RoutingSolver::violationTxt(const string &filename)
 }
 
 RoutingSolver::RoutingSolver(RoutingInst &inst)
+: RoutingSolver(inst, inst.nets)
+{ }
+
+RoutingSolver::RoutingSolver(const RoutingInst &inst, std::vector<Net> &nets)
 : gx(inst.gx)
 , gy(inst.gy)
+, grid(inst.geometry())
 , cap(inst.cap)
-, nets(inst.nets)
-, edgeCaps(inst.edgeCaps)
+, nets(nets)
+, numEdges(inst.numEdges())
 , inst(inst)
 {
-	for (unsigned int i = 0; i < inst.nets.size(); i++) {
-		nets_byid.push_back(&inst.nets[i]);
-		if (i != (unsigned int)inst.nets[i].id) {
+	edges.reset(inst.edgeCaps, grid, cap, EdgeState::bitsFor(inst.maxCap()));
+	ncCosts.setCapacities(cap, inst.edgeCaps, numEdges);
+	ncCosts.rebuild(iteration);
+
+	routeVersions.resize(nets.size());
+	for (unsigned int i = 0; i < nets.size(); i++) {
+		nets_byid.push_back(&nets[i]);
+		if (i != (unsigned int)nets[i].id) {
 			std::cout << "nets aren't ordered!!!\n";
 			exit(-1);
 		}
@@ -820,60 +1157,46 @@ RoutingSolver::~RoutingSolver()
 }
 
 
-namespace
-{
-	volatile std::sig_atomic_t signalHandlerCalls = 0;
-	
-	void handler(int n)
-	{
-		signalHandlerCalls++;
-		std::signal(n, SIG_DFL);
-	}
-	
-	struct SetHandler
-	{
-		int signalNumber;
-		
-		SetHandler(int signalNumber)
-		: signalNumber(signalNumber)
-		{
-			std::signal(signalNumber, &handler);
-		}
-		
-		~SetHandler()
-		{
-			std::signal(signalNumber, SIG_DFL);
-		}
-	};
-}
-
 void RoutingSolver::rrr()
 {
 	using std::chrono::steady_clock;
 
-	cout << "[2/2] Rip up and reroute...\n";
+	*console << "[2/2] Rip up and reroute...\n";
 	
 	
-	int deltaPenalty = 1;
 	int deltaViolation = 0;
 	int lastViolation = 0;
-	penalty = 20;
+	EdgeState::Totals totals;
 	const time_t startTime = time(nullptr);
+	auto lastCheckpoint = steady_clock::now();
+	vector<steady_clock::duration> iterationTimes; ///< of iterations that ran to the end
+
+	// The best solution seen so far, which is what gets written out
+	RouteSnapshot best;
+	ConvergenceMonitor::Sample bestSample{0, 0, 0};
+	int bestIteration = -1;
+	auto keepIfBest = [&](const ConvergenceMonitor::Sample &sample, int iter) {
+		if(best.empty() || ConvergenceMonitor::better(sample, bestSample)) {
+			best.capture(nets, routeVersions);
+			bestSample = sample;
+			bestIteration = iter;
+		}
+	};
 	
 	for(int iter = 0; true /* no iteration limit */; ++iter) {
 		++iteration;
-		if(steady_clock::now() >= procedureStartTime + timeLimit) {
-			cout << "Terminating due to expiration of time limit. Total time taken: " 
+		if(steady_clock::now() >= deadline) {
+			*console << "Terminating due to expiration of time limit. Total time taken: " 
 				<< chrono::duration_cast<chrono::seconds>(steady_clock::now() - procedureStartTime).count()
 				<< " seconds.\n";
 			break;
 		}
 		
-		if(signalHandlerCalls > 0) {
-			cout << "Terminating due to interrupt.\n";
+		if(interruptRequested()) {
+			*console << "Terminating due to interrupt.\n";
 			break;
 		}
-		cout << "--> Iteration " << iter << "\n";
+		*console << "--> Iteration " << iter << "\n";
 
 		updateEdgeWeights();
 
@@ -881,16 +1204,23 @@ void RoutingSolver::rrr()
 		for(auto &n : nets) if(hasViolation(n)) violations++;
 		if(iter == 0) lastViolation = violations;
 		deltaViolation = -lastViolation + violations;
+		lastViolation = violations;
 
+		totals = edges.totals();
+		convergence.record({totals.overflow, totals.util, violations});
+		keepIfBest(convergence.history().back(), iter);
+		penalty = convergence.adaptPenalty(penalty);
 
-		if(deltaViolation > 0) {
-			penalty += deltaPenalty;
-		} else {
-			penalty -= deltaPenalty;
+		if(convergence.converged()) {
+			*console << "Terminating as total overflow and wirelength improved by less than "
+			     << convergence.threshold * 100 << "% over the last " << convergence.window << " iterations.\n";
+			break;
 		}
-		
 
-		lastViolation = violations;
+		if(keepGoing && !keepGoing(iter, bestSample)) {
+			*console << "Terminating as asked by the caller.\n";
+			break;
+		}
 
 		if(useNetOrdering) {
 			for(auto &net : nets) {
@@ -900,12 +1230,12 @@ void RoutingSolver::rrr()
 
 			reorderNets(nets);
 		}
-		SetHandler signalHandlerSetting(SIGINT);
-		ProgressBar pbar(cout);
+		ProgressBar pbar(*console);
 		pbar.max = nets.size();
 		PeriodicRunner<chrono::milliseconds> printer(chrono::milliseconds(200));
 		int netsConsidered = 0;
 		int netsRerouted = 0;
+		int pathsRerouted = 0;
 
 		auto printFunc = [&]()
 		{
@@ -918,21 +1248,69 @@ void RoutingSolver::rrr()
 				.draw()
 				.writeln(setw(32), "Nets considered: ", netsConsidered, "/", nets.size())
 				.writeln(setw(32), "Nets rerouted: ", netsRerouted)
+				.writeln(setw(32), "Paths rerouted: ", pathsRerouted)
 				.writeln(setw(32), "Phase time elapsed: ", time(nullptr) - startTime, " seconds")
 				.writeln(setw(32), "Total time elapsed: ", 
 				         minutes, ":", setw(2), setfill('0'), seconds, setfill(' '))
 				.writeln(setw(32), "Overflow penalty: ", penalty)
-				.writeln(setw(32), "Violations: ", lastViolation, " (delta ", deltaViolation, ")");
-			if(signalHandlerCalls > 0) {
+				.writeln(setw(32), "Violations: ", lastViolation, " (delta ", deltaViolation, ")")
+				.writeln(setw(32), "Total overflow: ", totals.overflow)
+				.writeln(setw(32), "Wirelength: ", totals.util);
+			if(ripupMode == Options::RepairPaths) {
+				pbar.writeln(setw(32), "Local repairs: ", repairStats.repaired, "/", repairStats.attempted);
+			}
+			if(interruptRequested()) {
 				pbar
-					.writeln("\033[31m^C pressed. Will write output and terminate at end of current RRR iteration.")
+					.writeln("\033[31m^C pressed. Will write output and terminate after the net being rerouted.")
 					.writeln("To stop immediately without writing output press ^C again.\033[0m");
 			}
 		};
 
-		for(auto &n : nets) {
-			// always run for NC
-			if(costFunction == Options::NC || hasViolation(n)) {
+		// Expect the iteration to take as long as the slowest of the last
+		// three. If that won't fit before the deadline, reroute the most
+		// overflowed nets first and stop wherever the deadline falls.
+		steady_clock::duration expected(0);
+		for(size_t i = iterationTimes.size() - min<size_t>(3, iterationTimes.size()); i < iterationTimes.size(); ++i) {
+			expected = max(expected, iterationTimes[i]);
+		}
+		const auto iterationStart = steady_clock::now();
+		const bool partial = deadline - iterationStart < expected;
+		if(partial) {
+			*console << "Iteration expected to take " << chrono::duration_cast<chrono::milliseconds>(expected).count()
+			     << " ms with " << chrono::duration_cast<chrono::milliseconds>(deadline - iterationStart).count()
+			     << " ms left: rerouting the most overflowed nets first.\n";
+		}
+
+		// The rip-up queue: every net, most overflowed first if asked for
+		vector<Net *> queue;
+		for(auto &n : nets) queue.push_back(&n);
+		if(ripupByOverflow || partial) {
+			vector<int> contribution(nets.size());
+			for(auto &n : nets) contribution[&n - nets.data()] = overflowContribution(n);
+
+			stable_sort(queue.begin(), queue.end(), [&](const Net *a, const Net *b) {
+				return contribution[a - nets.data()] > contribution[b - nets.data()];
+			});
+		}
+
+		bool complete = true;
+		for(Net *np : queue) {
+			Net &n = *np;
+
+			if(steady_clock::now() >= deadline || interruptRequested()) {
+				complete = false;
+				break;
+			}
+			if(iterationNetBudget > 0 && netsRerouted >= iterationNetBudget) break;
+			if(iterationTimeBudget.count() > 0 && steady_clock::now() - iterationStart >= iterationTimeBudget) break;
+
+			if(ripupMode != Options::RipNets) {
+				const int paths = reroutePathsWithViolation(n);
+				pathsRerouted += paths;
+				netsRerouted += paths > 0;
+			}
+			// always run for NC and PathFinder
+			else if(costFunction != Options::Standard || hasViolation(n)) {
 
 				ripNet(n);
 				decomposeNet(n, useNetDecomposition);
@@ -941,6 +1319,7 @@ void RoutingSolver::rrr()
 				placeNet(n);
 
 				++netsRerouted;
+				pathsRerouted += n.nroute.size();
 			}
 			++netsConsidered;
 
@@ -948,10 +1327,391 @@ void RoutingSolver::rrr()
 		}
 		printFunc();
 		logViolationSvg();
+
+		if(complete) {
+			iterationTimes.push_back(steady_clock::now() - iterationStart);
+		}
+
+		if(!checkpointPath.empty() && steady_clock::now() - lastCheckpoint >= checkpointInterval) {
+			writeCheckpoint(checkpointPath);
+			lastCheckpoint = steady_clock::now();
+		}
+	}
+
+	// Checkpoint where RRR left off rather than the best solution, as that
+	// is the state the penalty and history correspond to
+	if(!checkpointPath.empty()) {
+		writeCheckpoint(checkpointPath);
+		*console << "Saved checkpoint to " << checkpointPath << "\n";
+	}
+
+	// Keep the final solution unless an earlier one was strictly better
+	totals = edges.totals();
+	if(!best.empty() && ConvergenceMonitor::better(bestSample, {totals.overflow, totals.util, 0})) {
+		*console << "Restoring the best solution, from before iteration " << bestIteration
+		     << ": total overflow " << bestSample.overflow << ", wirelength " << bestSample.wirelength
+		     << " (final: " << totals.overflow << ", " << totals.util << ")\n";
+
+		for(auto &n : nets) {
+			if(best.isCurrent(n.id, routeVersions)) continue;
+
+			const unsigned version = best.version(n.id);
+			ripNet(n);
+			n.nroute = best.route(n.id);
+			placeNet(n);
+			routeVersions[n.id] = version;
+		}
+	}
+
+	if(ripupMode == Options::RepairPaths && repairStats.attempted > 0) {
+		*console << "Local repairs: " << repairStats.repaired << " of " << repairStats.attempted
+		     << " overflowed paths (" << 100 * repairStats.repaired / repairStats.attempted
+		     << "%) without a full reroute\n";
 	}
 }
 
 
+void RoutingSolver::rrrOutOfCore(NetStore &store, size_t batchSize)
+{
+	using std::chrono::steady_clock;
+
+	*console << "[2/2] Rip up and reroute, " << batchSize << " nets in memory at a time...\n";
+
+	const time_t startTime = time(nullptr);
+	procedureStartTime = steady_clock::now();
+	int violations = 0; ///< nets that crossed an overflowed edge when last visited
+	vector<Net> batch;
+
+	for(int iter = 0; true /* no iteration limit */; ++iter) {
+		++iteration;
+		if(steady_clock::now() >= deadline) {
+			*console << "Terminating due to expiration of time limit. Total time taken: "
+				<< chrono::duration_cast<chrono::seconds>(steady_clock::now() - procedureStartTime).count()
+				<< " seconds.\n";
+			break;
+		}
+
+		if(interruptRequested()) {
+			*console << "Terminating due to interrupt.\n";
+			break;
+		}
+		*console << "--> Iteration " << iter << "\n";
+
+		updateEdgeWeights();
+
+		const EdgeState::Totals totals = edges.totals();
+		convergence.record({totals.overflow, totals.util, violations});
+		penalty = convergence.adaptPenalty(penalty);
+
+		if(convergence.converged()) {
+			*console << "Terminating as total overflow and wirelength improved by less than "
+			     << convergence.threshold * 100 << "% over the last " << convergence.window << " iterations.\n";
+			break;
+		}
+
+		ProgressBar pbar(*console);
+		pbar.max = store.size();
+		PeriodicRunner<chrono::milliseconds> printer(chrono::milliseconds(200));
+		size_t netsConsidered = 0;
+		int netsRerouted = 0;
+		int pathsRerouted = 0;
+		int violationsSeen = 0;
+
+		auto printFunc = [&]()
+		{
+			pbar.value = netsConsidered;
+			pbar
+				.draw()
+				.writeln(setw(32), "Nets considered: ", netsConsidered, "/", store.size())
+				.writeln(setw(32), "Nets rerouted: ", netsRerouted)
+				.writeln(setw(32), "Paths rerouted: ", pathsRerouted)
+				.writeln(setw(32), "Phase time elapsed: ", time(nullptr) - startTime, " seconds")
+				.writeln(setw(32), "Overflow penalty: ", penalty)
+				.writeln(setw(32), "Violations: ", violations)
+				.writeln(setw(32), "Total overflow: ", totals.overflow)
+				.writeln(setw(32), "Wirelength: ", totals.util)
+				.writeln(setw(32), "Spilled routes: ", store.liveBytes() >> 20, " MB (+", store.garbage() >> 20, " MB stale)");
+		};
+
+		// Visit the nets in ID order a batch at a time, writing back those
+		// that were rerouted
+		const auto iterationStart = steady_clock::now();
+		bool stop = false;
+		for(size_t first = 0; first < store.size() && !stop; first += batchSize) {
+			batch.resize(min(batchSize, store.size() - first));
+			for(size_t i = 0; i < batch.size(); ++i) {
+				store.get(first + i, batch[i]);
+			}
+
+			for(auto &n : batch) {
+				if(steady_clock::now() >= deadline || interruptRequested() ||
+				   (iterationNetBudget > 0 && netsRerouted >= iterationNetBudget) ||
+				   (iterationTimeBudget.count() > 0 && steady_clock::now() - iterationStart >= iterationTimeBudget)) {
+					stop = true;
+					break;
+				}
+
+				const bool violating = hasViolation(n);
+				violationsSeen += violating;
+
+				bool changed = false;
+				if(ripupMode != Options::RipNets) {
+					const int paths = reroutePathsWithViolation(n);
+					pathsRerouted += paths;
+					netsRerouted += paths > 0;
+					changed = paths > 0;
+				}
+				// always run for NC and PathFinder
+				else if(costFunction != Options::Standard || violating) {
+					ripNet(n);
+					decomposeNet(n, useNetDecomposition);
+					routeNet(n);
+					placeNet(n);
+
+					++netsRerouted;
+					pathsRerouted += n.nroute.size();
+					changed = true;
+				}
+
+				if(changed) store.put(n);
+				++netsConsidered;
+				printer.runPeriodically(printFunc);
+			}
+		}
+		violations = violationsSeen;
+		printFunc();
+
+		if(store.garbage() > store.liveBytes()) {
+			store.compact();
+		}
+	}
+
+	if(ripupMode == Options::RepairPaths && repairStats.attempted > 0) {
+		*console << "Local repairs: " << repairStats.repaired << " of " << repairStats.attempted
+		     << " overflowed paths (" << 100 * repairStats.repaired / repairStats.attempted
+		     << "%) without a full reroute\n";
+	}
+}
+
+namespace
+{
+	const char checkpointMagic[9] = "RRRCKPT1";
+}
+
+void RoutingSolver::writeCheckpoint(const std::string &path) const
+{
+	// Write a temporary file and rename it, so that being killed halfway
+	// never clobbers the previous checkpoint
+	const std::string tmp = path + ".tmp";
+	{
+		ofstream out(tmp, ios::binary);
+		if(!out) {
+			throw runtime_error("Couldn't open checkpoint file " + tmp + ": " + strerror(errno));
+		}
+
+		writeMagic(out, checkpointMagic);
+		writeBinary(out, gx);
+		writeBinary(out, gy);
+		writeBinary(out, grid.layout);
+		writeBinary(out, static_cast<uint64_t>(nets.size()));
+
+		writeBinary(out, iteration);
+		writeBinary(out, penalty);
+		writeBinary(out, negotiation.presentFactor);
+		writeBinary(out, repairStats);
+		convergence.write(out);
+		edges.write(out);
+
+		for(const auto &n : nets) {
+			writeBinary(out, n.id);
+			writeBinary(out, static_cast<uint64_t>(n.nroute.size()));
+			for(const auto &path : n.nroute) {
+				writeBinary(out, path.p1);
+				writeBinary(out, path.p2);
+				writeBinary(out, path.edges);
+			}
+		}
+
+		out.close();
+		if(!out) {
+			throw runtime_error("Couldn't write checkpoint file " + tmp);
+		}
+	}
+
+	if(std::rename(tmp.c_str(), path.c_str()) != 0) {
+		throw runtime_error("Couldn't replace checkpoint file " + path + ": " + strerror(errno));
+	}
+}
+
+void RoutingSolver::resumeFromCheckpoint(const std::string &path)
+{
+	ifstream in(path, ios::binary);
+	if(!in) {
+		throw runtime_error("Couldn't open checkpoint file " + path + ": " + strerror(errno));
+	}
+
+	expectMagic(in, checkpointMagic, "routing checkpoint");
+	if(readBinary<int>(in) != gx || readBinary<int>(in) != gy ||
+	   readBinary<GridGeometry::Layout>(in) != grid.layout ||
+	   readBinary<uint64_t>(in) != nets.size()) {
+		throw runtime_error("Checkpoint " + path + " is for a different instance or edge layout");
+	}
+
+	readBinary(in, iteration);
+	readBinary(in, penalty);
+	readBinary(in, negotiation.presentFactor);
+	readBinary(in, repairStats);
+	convergence.read(in);
+	edges.read(in);
+
+	// Routes come in the net order RRR had reached
+	vector<int> position(nets.size(), -1);
+	vector<Route> routes(nets.size());
+	for(size_t i = 0; i < nets.size(); ++i) {
+		const int id = readBinary<int>(in);
+		if(id < 0 || size_t(id) >= nets.size() || position[id] >= 0) {
+			throw runtime_error("Checkpoint " + path + " has an invalid or repeated net ID " + to_string(id));
+		}
+		position[id] = i;
+
+		routes[id].resize(readBinary<uint64_t>(in));
+		for(auto &p : routes[id]) {
+			readBinary(in, p.p1);
+			readBinary(in, p.p2);
+			readBinary(in, p.edges);
+			for(int e : p.edges) {
+				if(!grid.isEdge(e)) {
+					throw runtime_error("Checkpoint " + path + " routes net " + to_string(id) +
+					                    " over nonexistent edge " + to_string(e));
+				}
+			}
+		}
+	}
+
+	sort(nets.begin(), nets.end(), [&](const Net &a, const Net &b) {
+		return position[a.id] < position[b.id];
+	});
+	for(auto &n : nets) {
+		n.nroute = std::move(routes[n.id]);
+		++routeVersions[n.id];
+	}
+
+	// The saved utilization must be what the saved routes add up to
+	vector<int> util(grid.idSpace());
+	for(const auto &n : nets) {
+		unordered_set<int> counted;
+		for(const auto &p : n.nroute) {
+			for(int e : p.edges) {
+				if(counted.insert(e).second) ++util[e];
+			}
+		}
+	}
+	for(int i = 0; i < grid.idSpace(); ++i) {
+		if(util[i] != edges.util(i)) {
+			throw runtime_error("Checkpoint " + path + " is inconsistent: edge utilization doesn't match the routes");
+		}
+	}
+
+	if(findDependencyChains) {
+		for(const auto &n : nets) {
+			for(const auto &p : n.nroute) {
+				for(int e : p.edges) {
+					getElementResizingIfNecessary(edgeInfos, e, EdgeInfo{}).nets.insert(n.id);
+				}
+			}
+		}
+	}
+
+	procedureStartTime = chrono::steady_clock::now();
+}
+
+void RoutingSolver::applyOptions(const Options &opts)
+{
+	useNetDecomposition = opts.useNetDecomposition;
+	useNetOrdering = opts.useNetOrdering;
+	emitSVG = opts.emitSVG;
+	costFunction = opts.costFunction;
+	negotiation = opts.negotiation;
+	ripupMode = opts.ripupMode;
+	repairMargin = opts.repairMargin;
+	convergence.window = opts.convergenceWindow;
+	convergence.threshold = opts.convergenceThreshold;
+	ripupByOverflow = opts.ripupByOverflow;
+	iterationNetBudget = opts.iterationNetBudget;
+	iterationTimeBudget = std::chrono::milliseconds(opts.iterationTimeBudget);
+	checkpointPath = opts.checkpointFile;
+	checkpointInterval = std::chrono::seconds(opts.checkpointInterval);
+	if(opts.edgeBits != 0)
+		setEdgeBits(opts.edgeBits);
+}
+
+void RoutingSolver::warmStart(const std::string &path)
+{
+	ifstream in(path);
+	if(!in) {
+		throw runtime_error("Couldn't open solution file " + path + ": " + strerror(errno));
+	}
+
+	*console << "[1/2] Loading initial solution from " << path << "...\n";
+	auto solution = readSolution(in);
+
+	vector<NetEdges *> byID(nets.size(), nullptr);
+	for(auto &ne : solution) {
+		if(ne.id < 0 || size_t(ne.id) >= nets.size()) {
+			throw runtime_error("Solution " + path + " routes net n" + to_string(ne.id) + ", which the instance doesn't have");
+		}
+		if(byID[ne.id]) {
+			throw runtime_error("Solution " + path + " routes net n" + to_string(ne.id) + " twice");
+		}
+		byID[ne.id] = &ne;
+	}
+
+	decomposeAll();
+
+	for(auto &n : nets) {
+		if(!byID[n.id]) {
+			throw runtime_error("Solution " + path + " doesn't route net n" + to_string(n.id));
+		}
+
+		// cells the net's edges join
+		unordered_map<Point, vector<Point>> adjacent;
+		for(const auto &e : byID[n.id]->edges) {
+			if(e.p2.x >= gx || e.p2.y >= gy) {
+				throw runtime_error("Solution " + path + " routes net n" + to_string(n.id) + " outside the grid");
+			}
+			adjacent[e.p1].push_back(e.p2);
+			adjacent[e.p2].push_back(e.p1);
+		}
+
+		for(auto &p : n.nroute) {
+			// breadth-first search from p2 so the walk back from p1 runs p1 to p2
+			unordered_map<Point, Point> from{{p.p2, p.p2}};
+			queue<Point> q;
+			q.push(p.p2);
+			while(!q.empty() && !from.count(p.p1)) {
+				const Point c = q.front();
+				q.pop();
+				for(const auto &next : adjacent[c]) {
+					if(from.emplace(next, c).second) q.push(next);
+				}
+			}
+
+			if(!from.count(p.p1)) {
+				throw runtime_error("Solution " + path + " doesn't connect the pins of net n" + to_string(n.id));
+			}
+			for(Point c = p.p1; c != p.p2; c = from[c]) {
+				p.edges.push_back(edgeID(c, from[c]));
+			}
+		}
+
+		placeNet(n);
+		++routeVersions[n.id];
+	}
+
+	procedureStartTime = chrono::steady_clock::now();
+	logViolationSvg();
+}
+
 std::ostream &operator <<(std::ostream &os, const Point &p)
 {
 	return os << "Point{" << p.x << ", " << p.y << "}";
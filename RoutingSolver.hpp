@@ -1,13 +1,24 @@
 #ifndef ROUTINGSOLVER_HPP_WSYRWD
 #define ROUTINGSOLVER_HPP_WSYRWD
 
+#include <chrono>
+#include <functional>
+#include <iostream>
 #include <memory>
+#include <string>
 #include <vector>
 #include <set>
 #include <unordered_set>
 #include <unordered_map>
 #include "ece556.hpp"
 #include "RoutingInst.hpp"
+#include "EdgeState.hpp"
+#include "NCCostTable.hpp"
+#include "CostPolicies.hpp"
+#include "ConvergenceMonitor.hpp"
+#include "RouteSnapshot.hpp"
+#include "BoundedQueue.hpp"
+#include "NetStore.hpp"
 #include "options.hpp"
 
 void decomposeNets(std::vector<Net>& nets, bool useNetDcomposition);
@@ -19,17 +30,11 @@ void decomposeNet(Net& n, bool useNetDecomposition);
 /// Solves a routing instance
 class RoutingSolver {
 
+	/// Per-edge bookkeeping for dependency chain detection.
+	/// The numeric per-edge state lives in `edges`.
 	struct EdgeInfo
 	{
-		int overflowCount; // k_e^k
-		int weight; // w_e^k
-
 		std::set<int> nets;
-		
-		EdgeInfo()
-		: overflowCount(0)
-		, weight(0)
-		{ }
 	};
 
 	std::vector<EdgeInfo> edgeInfos;
@@ -40,40 +45,52 @@ class RoutingSolver {
 	int edgeWeight(const Edge &e) const;
 	int edgeWeight(int id) const;
 	int totalEdgeWeight(const Net &n) const;
+	int overflowContribution(const Net &n) const;
 	int netSpan(const Net &n) const;
 	int netOverlap(const Net &m, const Net &n) const;
 	int netOverlapArea(const Net &m, const Net &n) const;
 	int netArea(const Net &n) const;
 
 	bool hasViolation(const Net &n) const;
+	bool hasViolation(const Path &p) const;
+
+	/// Note that n's route changed, for RouteSnapshot. Nets the solver
+	/// doesn't hold (out of core) aren't tracked.
+	void routeChanged(const Net &n)
+	{
+		if(size_t(n.id) < routeVersions.size()) ++routeVersions[n.id];
+	}
+
+	/// Decompose every net into unrouted paths, taking the instance's
+	/// precomputed decomposition if it has the kind asked for
+	void decomposeAll();
 
 	int penalty = 20;
 
 	int edgeID(const Point &p1, const Point &p2) const
 	{
-		return inst.edgeID(p1, p2);
+		return grid.edgeID(p1, p2);
 	}
 
 	int edgeID(const Edge &e) const
 	{
-		return inst.edgeID(e);
+		return grid.edgeID(e);
 	}
 	
 	Edge edge(int edgeID) const
 	{
-		return inst.edge(edgeID);
+		return grid.edge(edgeID);
 	}
 
 	void setEdgeUtil(const Point &p1, const Point &p2, int util)
 	{
-		int id = edgeID(p1, p2);
-		getElementResizingIfNecessary(edgeUtils, id, 0) = util;
+		edges.widenFor(util);
+		edges.setUtil(edgeID(p1, p2), util);
 	}
 
 	int edgeUtil(const Point &p1, const Point &p2) const
 	{
-		int id = edgeID(p1, p2);
-		return getElementOrDefault(edgeUtils, id, 0);
+		return edges.util(edgeID(p1, p2));
 	}
 
 	int edgeUtil(const Edge &e) const
@@ -83,12 +100,13 @@ class RoutingSolver {
 
 	void setEdgeCap(const Point &p1, const Point &p2, int capacity)
 	{
-		inst.setEdgeCap(p1, p2, capacity);
+		edges.widenFor(capacity);
+		edges.setCap(edgeID(p1, p2), capacity);
 	}
 
 	int edgeCap(const Point &p1, const Point &p2) const
 	{
-		return inst.edgeCap(p1, p2);
+		return edges.cap(edgeID(p1, p2));
 	}
 
 	int edgeCap(const Edge &e) const
@@ -98,40 +116,116 @@ class RoutingSolver {
 
 	int gx; ///< x dimension of the global routing grid
 	int gy; ///< y dimension of the global routing grid
+	GridGeometry grid; ///< edge ID arithmetic for the gx by gy grid
 
 	int cap;
 	int iteration = 1;
 
 	std::vector<Net> &nets;
 	std::vector<Net *> nets_byid;
+	std::vector<unsigned> routeVersions; ///< by net ID, bumped whenever the net's route changes
 
 	int numEdges; ///< number of edges of the grid
-	std::vector<int> &edgeCaps; ///< array of the actual edge capacities after considering for blockage
-	std::vector<int> edgeUtils; ///< array of edge utilizations
+	EdgeState edges; ///< utilization, capacity and history of every edge
+	NCCostTable ncCosts; ///< edge costs of Options::NC in the current iteration
+	std::chrono::steady_clock::time_point procedureStartTime; ///< start of the current phase, for progress output
 	void logViolationSvg();
 public:
 	Options::CostFunction costFunction = Options::Standard;
-	RoutingInst &inst;
+	NegotiatedCongestion negotiation; ///< cost factors for Options::PathFinder
+	Options::RipupMode ripupMode = Options::RipNets;
+	bool ripupByOverflow = false; ///< reroute nets with the most overflow first
+	int repairMargin = 3; ///< cells a repair may detour around an overflowed stretch
+	int iterationNetBudget = 0; ///< most nets rerouted per RRR iteration, 0 for no limit
+	ConvergenceMonitor convergence; ///< penalty schedule and early stop of RRR
+	std::chrono::milliseconds iterationTimeBudget{0}; ///< most time rerouting per RRR iteration, 0 for no limit
+	const RoutingInst &inst;
 	bool emitSVG = false;
-	std::chrono::seconds timeLimit = std::chrono::seconds::max();
+	std::ostream *console = &std::cout; ///< where progress is reported
+	/// Where rrr() saves checkpoints (if not empty), and how often. It also
+	/// saves one when it stops, whether by interrupt, time limit or convergence.
+	std::string checkpointPath;
+	std::chrono::seconds checkpointInterval{60};
+
+	/// When rip-up and reroute has to be done by. It is checked after every
+	/// net, so at most one net's reroute runs past it.
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+	/// If set, asked after every RRR iteration with the iteration number and
+	/// the best solution so far; rrr() stops when it returns false. It may
+	/// be called from whichever thread runs rrr().
+	std::function<bool(int, const ConvergenceMonitor::Sample &)> keepGoing;
 
 	bool useNetDecomposition = true;
 	bool useNetOrdering = true;
 	bool findDependencyChains = false;
 
 	RoutingSolver(RoutingInst &inst);
+
+	/// Solve inst routing nets, which stand in for inst.nets. Solvers with
+	/// their own nets can share an instance and run concurrently.
+	RoutingSolver(const RoutingInst &inst, std::vector<Net> &nets);
 	~RoutingSolver();
 
+	/// Take the solver settings in opts, apart from the deadline
+	void applyOptions(const Options &opts);
+
+	/// Total overflow and wirelength of the current routes
+	EdgeState::Totals totals() const { return edges.totals(); }
+
+	/// Store per-edge state in 8, 16 or 32-bit elements, overriding the
+	/// width chosen from the instance's largest capacity
+	void setEdgeBits(unsigned bits) { edges.setBits(bits); }
+
 	bool neighbor(Point &p, unsigned int caseNumber);
 
+	/// Rectangle of grid cells a search may visit, bounds inclusive
+	struct SearchWindow {
+		int xmin, ymin, xmax, ymax;
+
+		bool contains(const Point &p) const
+		{
+			return p.x >= xmin && p.x <= xmax && p.y >= ymin && p.y <= ymax;
+		}
+	};
+
+	/// Outcomes of Options::RepairPaths since the solver was created
+	struct RepairStats {
+		long long attempted = 0; ///< overflowed paths a repair was tried on
+		long long repaired = 0;  ///< repairs that found a detour without overflow
+	};
+
+	RepairStats repairStats;
+
 
 	void reorderNets(std::vector<Net>& nets);
 	void reorderNetsFancy(std::vector<Net>& nets);
 
-	/// Use A* search to route a segment with the overflow 
-	/// penalty from the member variable `penalty`.
+	/// Use A* search to route a segment with the cost function
+	/// selected by `costFunction`.
 	void aStarRouteSeg(Path& s);
 
+	/// aStarRouteSeg(Path&) on edge state stored as T
+	template <typename T>
+	void aStarRouteSeg(Path& s, const EdgeState::Fields<T> &fields);
+
+	/// Use A* search to route a segment inside window, which must contain
+	/// both its ends, using only edges with spare capacity or that ownEdges
+	/// (counts of a net's paths on each edge) says the net already uses.
+	/// Returns false if there is no such route.
+	bool detourSeg(Path& s, const SearchWindow &window, const std::unordered_map<int, int> &ownEdges);
+
+	/// detourSeg() on edge state stored as T
+	template <typename T>
+	bool detourSeg(Path& s, const SearchWindow &window, const std::unordered_map<int, int> &ownEdges,
+	               const EdgeState::Fields<T> &fields);
+
+	/// Use A* search to route a segment inside window, costing edges
+	/// with the given policy from CostPolicies.hpp. Returns false, leaving
+	/// the segment unrouted, if the policy's usable edges don't connect it.
+	template <typename CostPolicy>
+	bool aStarRouteSeg(Path& s, const CostPolicy &edgeCost, const SearchWindow &window);
+
 	// L-shaped routing
 	void connectViaLine(std::vector<int>& s, Point p0, Point p1);
 	void ellRouteSeg(Path& s);
@@ -139,8 +233,28 @@ public:
 	void routeNet(Net& n);
 	void placeNet(const Net& n);
 	void ripNet(Net& n);
+
+	/// Rip up and reroute only the paths of n that cross an overflowed edge,
+	/// keeping its other paths and their share of the utilization in place.
+	/// Returns the number of paths rerouted.
+	int reroutePathsWithViolation(Net& n);
+
+	/// Replace the stretch of path from its first to its last overflowed
+	/// edge by a detour found within repairMargin cells of it, if the detour
+	/// adds no overflow. pathsUsing counts n's paths on each edge, as in
+	/// reroutePathsWithViolation(). On failure path is left as it was.
+	bool repairPath(Net& n, Path& path, std::unordered_map<int, int>& pathsUsing);
+
+	/// Take id out of n's route or put it back in, updating the edge's
+	/// utilization when no other path of n uses it
+	void releaseEdge(Net& n, int id, std::unordered_map<int, int>& pathsUsing);
+	void claimEdge(Net& n, int id, std::unordered_map<int, int>& pathsUsing);
 	int countViolations();
-	bool routeValid(Route& r, bool isplaced);
+
+	/// Whether every path of r is made of edges of the grid that connect its
+	/// two ends, and, if isplaced, whether each of those edges has
+	/// utilization to show for it
+	bool routeValid(const Route& r, bool isplaced) const;
 
 
 	void violationSvg(const std::string& fileName);
@@ -148,7 +262,46 @@ public:
 	void violationTxt(const std::string &filename);
 	
 	void solveRouting();
+
+	/// Build the initial solution like solveRouting(), routing nets as they
+	/// arrive, already decomposed, from a pipeline still reading the rest.
+	/// Each goes into the slot of its ID, so the solver's nets must be
+	/// placeholders with IDs 0 to N-1, or into spill if given, for nets
+	/// 0 to spill->size()-1. Returns once arrivals is closed and empty;
+	/// throws std::runtime_error if a net is repeated or missing.
+	void solveRoutingStreamed(BoundedQueue<Net> &arrivals, NetStore *spill = nullptr);
+
+	/// Load capacity overrides added to the instance since the solver was
+	/// made, such as blockages read after the nets were routed
+	void applyCapacityOverrides();
+
+	/// Rip up and reroute until the deadline, convergence or keepGoing stops
+	/// it, or ^C does if the caller installed an InterruptGuard
 	void rrr();
+
+	/// Rip-up and reroute for nets kept in store rather than in the solver,
+	/// loading batchSize of them at a time in ID order and storing back
+	/// those it reroutes. Otherwise like rrr(), except that nets are never
+	/// reordered and the final solution is kept rather than the best one,
+	/// as either would need every net in memory.
+	void rrrOutOfCore(NetStore &store, size_t batchSize);
+
+	/// Save everything rrr() needs to carry on later: per-edge state,
+	/// penalty, iteration, convergence history and every net's route.
+	/// The file is replaced atomically.
+	void writeCheckpoint(const std::string &path) const;
+
+	/// Load a checkpoint written by writeCheckpoint() for the same instance
+	/// and edge layout, in place of solveRouting(). Throws std::runtime_error
+	/// if it doesn't match the instance or is inconsistent.
+	void resumeFromCheckpoint(const std::string &path);
+
+	/// Load a routing solution written by Writer for this instance, in place
+	/// of solveRouting(). Each net's segments are decomposed as solveRouting()
+	/// would and every segment takes the shortest way between its ends over
+	/// the net's edges in the file; edges on no such way are dropped. Throws
+	/// std::runtime_error if the solution lacks a net or doesn't connect its pins.
+	void warmStart(const std::string &path);
 };
 
 
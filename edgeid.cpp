@@ -1,103 +1,122 @@
-
-#include <set>
 #include <iostream>
-#include <cassert>
-#include <cmath>
-#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
 #include "edgeid.hpp"
-#include "ece556.hpp"
+#include "GridGeometry.hpp"
 
 
+// A few spot checks of the layout that need no running
+static_assert(GridGeometry(4, 6).horizontalEdgeID(2, 1) == 5, "horizontal edges are row-major");
+static_assert(GridGeometry(4, 6).verticalEdgeID(0, 0) == 18, "vertical edges follow horizontal ones");
+static_assert(GridGeometry(4, 6).edgeID(3, 2, 3, 1) == 25, "edge IDs ignore endpoint order");
+static_assert(GridGeometry(4, 6).numEdges() == 38, "");
+static_assert(GridGeometry(4, 6, GridGeometry::Tiled).verticalEdgeID(1, 1) == 19, "tiles keep a cell's edges together");
+static_assert(GridGeometry(20, 6, GridGeometry::Tiled).horizontalEdgeID(8, 0) == 128, "tiles are stored one after another");
 
-int horizontalEdgeID(int width, int height, int x, int y);
-int verticalEdgeID(int width, int height, int x, int y);
+int edgeID(int width, int height, int x1, int y1, int x2, int y2)
+{
+	return GridGeometry(width, height).edgeID(x1, y1, x2, y2);
+}
 
-int horizontalEdgeID(int width, int height, int x, int y)
+int edgeID(int width, int height, const Edge &e)
 {
-	(void)height;
-	return (width - 1) * y + x;
+	return GridGeometry(width, height).edgeID(e);
 }
 
 
-int verticalEdgeID(int width, int height, int x, int y)
+Edge edge(int width, int height, int edgeID)
 {
-	return (width - 1) * height + width * y + x;
+	return GridGeometry(width, height).edge(edgeID);
 }
 
-int edgeID(int width, int height, int x1, int y1, int x2, int y2)
+namespace {
+
+void check(bool ok, const GridGeometry &g, const std::string &what)
 {
-	if(x1 == x2) {
-		assert(abs(y2 - y1) == 1);
-		return verticalEdgeID(width, height, x1, std::min(y1, y2));
-	}
-	else if(y1 == y2) {
-		assert(abs(x2 - x1) == 1);
-		return horizontalEdgeID(width, height, std::min(x1, x2), y1);
-	}
-	else {
-		assert(false && "edgeID: edges must be horizontal or vertical");
-		return -1;
+	if(!ok) {
+		std::stringstream ss;
+		ss << "edge ID test failed on " << g.width << "x" << g.height << " grid: " << what;
+		throw std::logic_error(ss.str());
 	}
 }
 
-int edgeID(int width, int height, const Edge &e)
+/// Check every edge and every cell of one grid
+void testGrid(const GridGeometry &g)
 {
-	return edgeID(width, height, e.p1.x, e.p1.y, e.p2.x, e.p2.y);
-}
+	std::vector<bool> seen(g.idSpace(), false);
 
+	auto checkEdge = [&](const Edge &e) {
+		const int id = g.edgeID(e);
+		std::stringstream ss;
+		ss << e << " -> " << id;
 
-Edge edge(int width, int height, int edgeID)
-{
-	int minVert = (width - 1) * height;
-	bool isVert = edgeID >= minVert;
-	if(isVert) edgeID -= minVert;
+		check(id >= 0 && id < g.idSpace(), g, ss.str() + " is out of range");
+		check(!seen[id], g, ss.str() + " is a duplicate");
+		seen[id] = true;
+
+		check(g.edgeID(e.p2, e.p1) == id, g, ss.str() + " depends on endpoint order");
 
+		const Edge back = g.edge(id);
+		ss << " -> " << back;
+		check(back == e, g, ss.str() + " does not round-trip");
+	};
 
-	if(isVert) { // vertical
-		int x = edgeID % (width);
-		int y = edgeID / (width);
-		return {{x,y}, {x, y+1}};
+	for(int y = 0; y < g.height; ++y) {
+		for(int x = 0; x < g.width; ++x) {
+			if(x < g.width - 1) checkEdge(Edge::horizontal({x, y}));
+			if(y < g.height - 1) checkEdge(Edge::vertical({x, y}));
+		}
+	}
+
+	// Every ID is either produced by exactly one edge or a hole
+	for(int id = 0; id < g.idSpace(); ++id) {
+		check(seen[id] == g.isEdge(id), g, "edge ID " + std::to_string(id) +
+		      (seen[id] ? " is produced but not an edge" : " is an edge but never produced"));
 	}
-	else { // horizontal
-		int x = edgeID % (width - 1);
-		int y = edgeID / (width - 1);
-		return {{x, y}, {x+1, y}};
+	if(g.layout == GridGeometry::RowMajor) {
+		check(g.idSpace() == g.numEdges(), g, "row-major IDs are not dense");
 	}
-}
 
-void testEdgeID()
-{
-	const int width = 4, height = 6;
+	// Neighbour edge IDs and cell stepping must agree with the plain arithmetic
+	const Point offsets[] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+	for(int y = 0; y < g.height; ++y) {
+		for(int x = 0; x < g.width; ++x) {
+			const auto cell = g.cellEdges(x, y);
 
-	std::set<int> seen;
+			for(int d = GridGeometry::West; d <= GridGeometry::North; ++d) {
+				const auto dir = static_cast<GridGeometry::Direction>(d);
+				const Point p{x + offsets[d].x, y + offsets[d].y};
+				if(p.x < 0 || p.y < 0 || p.x >= g.width || p.y >= g.height) continue;
 
-	for(int y = 0; y < height; ++y) {
-		for(int x = 0; x < width; ++x) {
+				std::stringstream ss;
+				ss << "direction " << d << " from " << Point{x, y};
 
-			if(x < width - 1) {
-				auto horiz = Edge::horizontal({x, y});
-				int horizID = edgeID(width, height, horiz);
-				auto reconHorizEdge = edge(width, height, horizID);
-				assert(!seen.count(horizID));
-				seen.insert(horizID);
-				assert(reconHorizEdge == horiz);
+				check(g.edgeToward(cell, dir) == g.edgeID({x, y}, p), g, "edgeToward " + ss.str());
 
-				std::cout << horiz << " -> " << horizID << " -> " << reconHorizEdge << "\n";
+				const auto stepped = g.step(cell, dir);
+				const auto direct = g.cellEdges(p);
+				check(stepped.east == direct.east && stepped.north == direct.north, g, "step " + ss.str());
 			}
+		}
+	}
+}
 
+} // end anonymous namespace
 
-
-			if(y < height - 1) {
-				auto vert = Edge::vertical({x, y});
-				int vertID = edgeID(width, height, vert);
-				auto reconVertEdge = edge(width, height, vertID);
-				assert(!seen.count(vertID));
-				seen.insert(vertID);
-				assert(reconVertEdge == vert);
-	
-				std::cout << vert << " -> " << vertID << " -> " << reconVertEdge << "\n";
-			}
+void testEdgeID()
+{
+	const Point sizes[] = {
+		{2, 2}, {4, 6}, {6, 4}, {1, 5}, {5, 1}, {7, 3}, {8, 8}, {9, 16}, {33, 17}, {128, 96}
+	};
+
+	for(auto layout : {GridGeometry::RowMajor, GridGeometry::Tiled}) {
+		for(const auto &size : sizes) {
+			const GridGeometry g(size.x, size.y, layout);
+			testGrid(g);
+			std::cout << (layout == GridGeometry::RowMajor ? "row-major " : "tiled ")
+			          << g.width << "x" << g.height << ": " << g.numEdges() << " edges OK\n";
 		}
 	}
-}
\ No newline at end of file
+}
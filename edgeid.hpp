@@ -4,6 +4,9 @@
 
 struct Edge;
 
+// Out-of-line wrappers around GridGeometry, which callers on hot paths
+// should use directly so the arithmetic is inlined.
+
 /// Convert a line segment of length one into an edge ID.
 /// \param width   The number of vertical divisions in the grid.
 /// \param height  The number of horizontal divisions in the grid.
@@ -16,6 +19,11 @@ int edgeID(int width, int height, const Edge &);
 /// \sa edgeID(int width, int height, int x1, int y1, int x2, int y2)
 Edge edge(int width, int height, int edgeID);
 
+/// Exhaustively check GridGeometry on a range of grid shapes in each layout:
+/// every edge round-trips through its ID, IDs are unique and cover exactly
+/// the non-hole part of the ID space, and the neighbour stepping helpers
+/// agree with the direct arithmetic.
+/// Throws std::logic_error describing the first mismatch.
 void testEdgeID();
 
-#endif // EDGEID_HPP_NK084F
\ No newline at end of file
+#endif // EDGEID_HPP_NK084F
@@ -0,0 +1,182 @@
+#include "evaluator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include "IteratorUtils.hpp"
+
+using namespace std;
+
+namespace
+{
+	/// Nets evaluated per task
+	const size_t netsPerTask = 1024;
+
+	uint64_t pointKey(const Point &p)
+	{
+		return uint64_t(uint32_t(p.x)) << 32 | uint32_t(p.y);
+	}
+
+	/// Union-find over the points of one net's edges
+	struct Components {
+		vector<uint64_t> keys; ///< sorted, so a point's index is its rank
+		vector<int> parent;
+
+		int find(const Point &p)
+		{
+			const auto it = lower_bound(keys.begin(), keys.end(), pointKey(p));
+			if(it == keys.end() || *it != pointKey(p)) return -1;
+
+			int i = it - keys.begin();
+			while(parent[i] != i) {
+				parent[i] = parent[parent[i]];
+				i = parent[i];
+			}
+			return i;
+		}
+
+		void join(const Point &a, const Point &b)
+		{
+			parent[find(a)] = find(b);
+		}
+	};
+
+	/// The nets of one task's share, summed once all tasks are done
+	struct Partial {
+		int routed = 0;
+		int invalid = 0;
+		long long wirelength = 0;
+	};
+
+	/// Evaluate entries 0 to count-1 of a solution, each a net's route.
+	/// routeOf(i, ids) stores the edge IDs of entry i in ids, with -1 for
+	/// any edge off the grid, and returns the net it routes.
+	template <typename F>
+	Evaluation evaluateEntries(const RoutingInst &inst, size_t count, const F &routeOf)
+	{
+		const GridGeometry grid = inst.geometry();
+		vector<atomic<int>> util(grid.idSpace());
+
+		const size_t tasks = (count + netsPerTask - 1) / netsPerTask;
+		vector<Partial> partials(tasks);
+		vector<size_t> taskIndices(tasks);
+		for(size_t t = 0; t < tasks; ++t) taskIndices[t] = t;
+
+		parallelForEach(taskIndices.begin(), taskIndices.end(), [&](size_t t) {
+			Partial &partial = partials[t];
+			vector<int> ids;
+
+			const size_t end = min(count, (t + 1) * netsPerTask);
+			for(size_t i = t * netsPerTask; i < end; ++i) {
+				ids.clear();
+				const Net &net = routeOf(i, ids);
+
+				sort(ids.begin(), ids.end());
+				ids.erase(unique(ids.begin(), ids.end()), ids.end());
+				const bool offGrid = !ids.empty() && ids.front() < 0;
+				if(offGrid) ids.erase(ids.begin());
+
+				for(int id : ids) util[id].fetch_add(1, memory_order_relaxed);
+				++partial.routed;
+				partial.wirelength += ids.size();
+				partial.invalid += offGrid || !connectsAll(grid, ids, net.pins);
+			}
+		});
+
+		Evaluation result;
+		result.nets = inst.nets.size();
+		for(const auto &p : partials) {
+			result.routedNets += p.routed;
+			result.invalidNets += p.invalid;
+			result.wirelength += p.wirelength;
+		}
+
+		vector<int> caps(grid.idSpace(), inst.cap);
+		for(const auto &o : inst.edgeCaps.entries()) {
+			if(grid.isEdge(o.first)) caps[o.first] = o.second;
+		}
+
+		for(int id = 0; id < grid.idSpace(); ++id) {
+			const int overflow = util[id].load(memory_order_relaxed) - caps[id];
+			if(overflow > 0 && grid.isEdge(id)) {
+				result.totalOverflow += overflow;
+				result.maxOverflow = max(result.maxOverflow, overflow);
+			}
+		}
+
+		return result;
+	}
+}
+
+std::ostream &operator <<(std::ostream &out, const Evaluation &e)
+{
+	return out << "nets " << e.routedNets << "/" << e.nets << " invalid " << e.invalidNets
+	           << " TOF " << e.totalOverflow << " MOF " << e.maxOverflow << " WL " << e.wirelength;
+}
+
+bool connectsAll(const GridGeometry &grid, const std::vector<int> &edgeIDs, const std::vector<Point> &pins)
+{
+	const bool onePoint = all_of(pins.begin(), pins.end(), [&](const Point &p) { return p == pins.front(); });
+	if(onePoint) return true;
+
+	Components points;
+	for(int id : edgeIDs) {
+		const Edge e = grid.edge(id);
+		points.keys.push_back(pointKey(e.p1));
+		points.keys.push_back(pointKey(e.p2));
+	}
+	sort(points.keys.begin(), points.keys.end());
+	points.keys.erase(unique(points.keys.begin(), points.keys.end()), points.keys.end());
+	points.parent.resize(points.keys.size());
+	for(size_t i = 0; i < points.parent.size(); ++i) points.parent[i] = i;
+
+	for(int id : edgeIDs) {
+		const Edge e = grid.edge(id);
+		points.join(e.p1, e.p2);
+	}
+
+	const int root = points.find(pins.front());
+	return root >= 0 && all_of(pins.begin(), pins.end(), [&](const Point &p) { return points.find(p) == root; });
+}
+
+Evaluation evaluate(const RoutingInst &inst)
+{
+	return evaluateEntries(inst, inst.nets.size(), [&](size_t i, vector<int> &ids) -> const Net & {
+		const Net &net = inst.nets[i];
+		for(const auto &path : net.nroute) {
+			ids.insert(ids.end(), path.edges.begin(), path.edges.end());
+		}
+		return net;
+	});
+}
+
+Evaluation evaluate(const RoutingInst &inst, const std::vector<NetEdges> &solution)
+{
+	vector<const Net *> byID(inst.nets.size(), nullptr);
+	for(const auto &net : inst.nets) {
+		byID.at(net.id) = &net;
+	}
+
+	vector<bool> seen(byID.size(), false);
+	for(const auto &entry : solution) {
+		if(entry.id < 0 || size_t(entry.id) >= byID.size() || !byID[entry.id]) {
+			throw runtime_error("The solution routes net n" + to_string(entry.id) + ", which the instance doesn't have");
+		}
+		if(seen[entry.id]) {
+			throw runtime_error("The solution routes net n" + to_string(entry.id) + " more than once");
+		}
+		seen[entry.id] = true;
+	}
+
+	const GridGeometry grid = inst.geometry();
+	return evaluateEntries(inst, solution.size(), [&](size_t i, vector<int> &ids) -> const Net & {
+		for(const auto &e : solution[i].edges) {
+			const bool inside = e.p1.x >= 0 && e.p1.y >= 0 && e.p2.x < grid.width && e.p2.y < grid.height;
+			ids.push_back(inside ? grid.edgeID(e) : -1);
+		}
+		return *byID[solution[i].id];
+	});
+}
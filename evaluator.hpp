@@ -0,0 +1,40 @@
+/// \file
+#ifndef EVALUATOR_HPP_R4KD8V
+#define EVALUATOR_HPP_R4KD8V
+
+#include <iosfwd>
+#include <vector>
+#include "GridGeometry.hpp"
+#include "RoutingInst.hpp"
+#include "reader.hpp"
+
+/// Quality of a routing solution, measured the way the course evaluation
+/// script measures it: each net counts once on every distinct unit edge it
+/// uses, whichever of its paths use the edge.
+struct Evaluation {
+	int nets = 0;                 ///< nets in the instance
+	int routedNets = 0;           ///< nets the solution gives a route
+	int invalidNets = 0;          ///< routed nets that don't connect all their pins or leave the grid
+	long long totalOverflow = 0;  ///< TOF, summed over edges
+	int maxOverflow = 0;          ///< MOF, of any one edge
+	long long wirelength = 0;     ///< distinct unit edges, summed over nets
+};
+
+/// One line, e.g. `nets 40000/40000 invalid 0 TOF 308863 MOF 13 WL 785674`
+std::ostream &operator <<(std::ostream &, const Evaluation &);
+
+/// Score the instance's nets as routed, from the edges of their paths.
+/// Nets are checked on several threads.
+Evaluation evaluate(const RoutingInst &inst);
+
+/// Score a solution read by readSolution() against inst, ignoring any
+/// routes inst's nets have. Nets missing from the solution aren't routed.
+/// Throws std::runtime_error if it names a net inst doesn't have, or the
+/// same net twice.
+Evaluation evaluate(const RoutingInst &inst, const std::vector<NetEdges> &solution);
+
+/// Whether the unit edges with the given IDs, taken as an undirected graph,
+/// connect every one of pins. Repeated IDs are fine.
+bool connectsAll(const GridGeometry &grid, const std::vector<int> &edgeIDs, const std::vector<Point> &pins);
+
+#endif // EVALUATOR_HPP_R4KD8V
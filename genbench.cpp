@@ -0,0 +1,306 @@
+// Synthetic benchmark generator: writes routing instances in the format
+// Reader and MappedReader accept, with tunable size and congestion.
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <getopt.h>
+
+#include "GridGeometry.hpp"
+#include "options.hpp"
+
+namespace {
+
+/// What to generate. Everything is drawn from one generator seeded with
+/// seed, so the same parameters always give the same file.
+struct GeneratorOptions {
+	int width = 1000;  ///< gx
+	int height = 1000; ///< gy
+	int capacity = 20; ///< default capacity of every edge
+	int nets = 10000;
+
+	/// Pin counts and their relative weights
+	std::vector<std::pair<int, double>> pinCounts{{2, 60}, {3, 20}, {4, 10}, {5, 5}, {8, 3}, {16, 2}};
+
+	/// Pins of a two-pin net lie within span cells of the net's center in
+	/// each direction; nets with k pins spread over span * sqrt(k/2)
+	int span = 8;
+
+	int hotspots = 0;           ///< congested clusters
+	double hotspotShare = 0.5;  ///< fraction of nets centered around a hotspot
+	double hotspotRadius = 0;   ///< standard deviation of their distance to it, 0 for 1/20 of the grid
+
+	/// Fraction of edges blocked, each down to a capacity between 0 and
+	/// half the default
+	double blockageDensity = 0.001;
+
+	std::uint64_t seed = 1;
+	std::string outputFile;
+
+	void setGrid(const std::string &s)
+	{
+		char x;
+		std::istringstream in(s);
+		if(!(in >> width >> x >> height) || x != 'x' || width < 2 || height < 2) {
+			throw std::runtime_error("Expected a grid size like 4000x4000, not " + s);
+		}
+	}
+
+	/// Parse a distribution like `2:60,3:20,4:10` (pin count:weight)
+	void setPinCounts(const std::string &s)
+	{
+		pinCounts.clear();
+		std::istringstream in(s);
+		std::string item;
+		while(std::getline(in, item, ',')) {
+			const auto colon = item.find(':');
+			if(colon == std::string::npos) {
+				throw std::runtime_error("Expected pin count:weight, not " + item);
+			}
+			const int count = Options::parseCount("--pins", item.substr(0, colon));
+			const double weight = Options::parseFactor("--pins", item.substr(colon + 1));
+			if(count < 1) {
+				throw std::runtime_error("Nets need at least one pin, not " + item);
+			}
+			pinCounts.emplace_back(count, weight);
+		}
+
+		double total = 0;
+		for(const auto &p : pinCounts) total += p.second;
+		if(total <= 0) {
+			throw std::runtime_error("Expected a pin count distribution with some weight, not " + s);
+		}
+	}
+};
+
+/// Random numbers from std::mt19937_64, whose sequence the standard fixes,
+/// converted by hand rather than through the std distributions, whose
+/// results differ between standard libraries
+class Random {
+	std::mt19937_64 engine;
+
+public:
+	explicit Random(std::uint64_t seed)
+	: engine(seed)
+	{ }
+
+	/// Uniform in [0, 1)
+	double real()
+	{
+		return (engine() >> 11) * (1.0 / (std::uint64_t(1) << 53));
+	}
+
+	/// Uniform in [0, n), without modulo bias
+	std::uint64_t below(std::uint64_t n)
+	{
+		const std::uint64_t limit = ~std::uint64_t(0) - ~std::uint64_t(0) % n;
+		std::uint64_t r;
+		do {
+			r = engine();
+		} while(r >= limit);
+		return r % n;
+	}
+
+	/// Uniform in [lo, hi]
+	int between(int lo, int hi)
+	{
+		return lo + int(below(std::uint64_t(hi - lo) + 1));
+	}
+
+	/// Standard normal, by the Box-Muller transform
+	double normal()
+	{
+		const double pi = std::acos(-1.0);
+		const double u = 1 - real(); // in (0, 1], for the log
+		return std::sqrt(-2 * std::log(u)) * std::cos(2 * pi * real());
+	}
+};
+
+int clamp(int v, int lo, int hi)
+{
+	return std::max(lo, std::min(hi, v));
+}
+
+void generate(const GeneratorOptions &opts, std::FILE *out)
+{
+	Random random(opts.seed);
+
+	std::vector<double> cumulative;
+	double total = 0;
+	for(const auto &p : opts.pinCounts) {
+		total += p.second;
+		cumulative.push_back(total);
+	}
+	auto pinCount = [&]() {
+		const auto it = std::upper_bound(cumulative.begin(), cumulative.end(), random.real() * total);
+		return opts.pinCounts[std::min<size_t>(it - cumulative.begin(), cumulative.size() - 1)].first;
+	};
+
+	std::vector<Point> hotspots(opts.hotspots);
+	for(auto &h : hotspots) {
+		h = Point{random.between(0, opts.width - 1), random.between(0, opts.height - 1)};
+	}
+	const double radius = opts.hotspotRadius > 0 ? opts.hotspotRadius : std::max(opts.width, opts.height) / 20.0;
+
+	std::fprintf(out, "grid %d %d\ncapacity %d\nnum net %d\n", opts.width, opts.height, opts.capacity, opts.nets);
+
+	for(int id = 0; id < opts.nets; ++id) {
+		Point center;
+		if(!hotspots.empty() && random.real() < opts.hotspotShare) {
+			const Point &h = hotspots[random.below(hotspots.size())];
+			center.x = clamp(int(std::lround(h.x + radius * random.normal())), 0, opts.width - 1);
+			center.y = clamp(int(std::lround(h.y + radius * random.normal())), 0, opts.height - 1);
+		}
+		else {
+			center = Point{random.between(0, opts.width - 1), random.between(0, opts.height - 1)};
+		}
+
+		const int pins = pinCount();
+		const int reach = std::max(1, int(std::lround(opts.span * std::sqrt(pins / 2.0))));
+		const int x0 = std::max(0, center.x - reach), x1 = std::min(opts.width - 1, center.x + reach);
+		const int y0 = std::max(0, center.y - reach), y1 = std::min(opts.height - 1, center.y + reach);
+
+		std::fprintf(out, "n%d %d\n", id, pins);
+		for(int i = 0; i < pins; ++i) {
+			std::fprintf(out, "%d %d\n", random.between(x0, x1), random.between(y0, y1));
+		}
+	}
+
+	// Blocked edges, visited in ID order by jumping geometrically
+	// distributed gaps rather than drawing once per edge
+	const GridGeometry grid(opts.width, opts.height);
+	std::vector<int> blocked;
+	if(opts.blockageDensity >= 1) {
+		for(int id = 0; id < grid.numEdges(); ++id) blocked.push_back(id);
+	}
+	else if(opts.blockageDensity > 0) {
+		const double logMiss = std::log(1 - opts.blockageDensity);
+		for(double id = -1;;) {
+			id += 1 + std::floor(std::log(1 - random.real()) / logMiss);
+			if(id >= grid.numEdges()) break;
+			blocked.push_back(int(id));
+		}
+	}
+
+	std::fprintf(out, "%zu\n", blocked.size());
+	for(int id : blocked) {
+		const Edge e = grid.edge(id);
+		std::fprintf(out, "%d %d %d %d %d\n", e.p1.x, e.p1.y, e.p2.x, e.p2.y, random.between(0, opts.capacity / 2));
+	}
+}
+
+// [[noreturn]]
+void usage(const char *program)
+{
+	std::cerr << "Usage: " << program << " [--grid WxH] [--capacity C] [--nets N] [--pins K:W,...] [--span S]\n"
+	             "       [--hotspots H] [--hotspot-share F] [--hotspot-radius R] [--blockages D] [--seed S] OUTPUT\n"
+	             "Writes a routing benchmark to OUTPUT (- for standard output).\n";
+	std::exit(1);
+}
+
+GeneratorOptions parseOpts(int argc, char **argv)
+{
+	GeneratorOptions result;
+	const char *program = argc > 0 ? argv[0] : "genbench";
+	opterr = 0;
+
+	option longopts[] = {
+		{"help", no_argument, nullptr, 'h'},
+		{"grid", required_argument, nullptr, 'g'},
+		{"capacity", required_argument, nullptr, 'c'},
+		{"nets", required_argument, nullptr, 'n'},
+		{"pins", required_argument, nullptr, 'p'},
+		{"span", required_argument, nullptr, 's'},
+		{"hotspots", required_argument, nullptr, 'H'},
+		{"hotspot-share", required_argument, nullptr, 'F'},
+		{"hotspot-radius", required_argument, nullptr, 'R'},
+		{"blockages", required_argument, nullptr, 'b'},
+		{"seed", required_argument, nullptr, 'S'},
+		{nullptr, 0, nullptr, 0}
+	};
+
+	int ch;
+	while((ch = getopt_long(argc, argv, "h", longopts, nullptr)) != -1) {
+		switch(ch) {
+			case 'g': {
+				result.setGrid(optarg);
+			} break;
+			case 'c': {
+				result.capacity = Options::parseCount("--capacity", optarg);
+			} break;
+			case 'n': {
+				result.nets = Options::parseCount("--nets", optarg);
+			} break;
+			case 'p': {
+				result.setPinCounts(optarg);
+			} break;
+			case 's': {
+				result.span = Options::parseCount("--span", optarg);
+			} break;
+			case 'H': {
+				result.hotspots = Options::parseCount("--hotspots", optarg);
+			} break;
+			case 'F': {
+				result.hotspotShare = Options::parseFactor("--hotspot-share", optarg);
+			} break;
+			case 'R': {
+				result.hotspotRadius = Options::parseFactor("--hotspot-radius", optarg);
+			} break;
+			case 'b': {
+				result.blockageDensity = Options::parseFactor("--blockages", optarg);
+			} break;
+			case 'S': {
+				result.seed = Options::parseCount("--seed", optarg);
+			} break;
+			case 'h': {
+				usage(program);
+			} break;
+			default: {
+				std::cerr << "Unrecognized option: " << argv[optind - 1] << "\n";
+				usage(program);
+			} break;
+		}
+	}
+
+	if(argc - optind != 1) {
+		usage(program);
+	}
+	result.outputFile = argv[optind];
+	return result;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+{
+	try {
+		const auto opts = parseOpts(argc, argv);
+
+		const bool toStdout = opts.outputFile == "-";
+		std::FILE *out = toStdout ? stdout : std::fopen(opts.outputFile.c_str(), "w");
+		if(!out) {
+			throw std::runtime_error("Couldn't open output file: " + std::string(std::strerror(errno)));
+		}
+
+		generate(opts, out);
+
+		if(std::fflush(out) != 0 || (!toStdout && std::fclose(out) != 0)) {
+			throw std::runtime_error("Couldn't write output file: " + std::string(std::strerror(errno)));
+		}
+		return 0;
+	}
+	catch(std::exception &ex) {
+		std::fprintf(stderr, "Error: %s\n", ex.what());
+		return 1;
+	}
+}
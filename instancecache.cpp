@@ -0,0 +1,212 @@
+#include "instancecache.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+#include "BinaryIO.hpp"
+#include "mappedreader.hpp"
+
+namespace {
+
+const char cacheMagic[9] = "ROUTEIC1";
+
+/// What identifies the version of a file the cache was made from
+struct SourceStamp {
+	std::int64_t size;
+	std::int64_t mtimeSec;
+	std::int64_t mtimeNsec;
+
+	bool operator ==(const SourceStamp &that) const
+	{
+		return size == that.size && mtimeSec == that.mtimeSec && mtimeNsec == that.mtimeNsec;
+	}
+};
+
+SourceStamp stampOf(const std::string &path)
+{
+	struct stat st;
+	if(stat(path.c_str(), &st) != 0) {
+		throw std::runtime_error("Couldn't stat " + path + ": " + std::strerror(errno));
+	}
+	return SourceStamp{st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec};
+}
+
+bool fileExists(const std::string &path)
+{
+	struct stat st;
+	return stat(path.c_str(), &st) == 0;
+}
+
+/// Check offsets into an array of elementSize-byte elements stored next in
+/// in, before anything is sized by them: they must start at 0, never
+/// decrease, and end within the bytes left
+void checkOffsets(const std::vector<std::uint64_t> &offsets, size_t elementSize, const BinaryBuffer &in,
+                  const std::string &what)
+{
+	bool valid = !offsets.empty() && offsets.front() == 0 && offsets.back() <= in.remaining() / elementSize;
+	for(size_t i = 1; valid && i < offsets.size(); ++i) {
+		valid = offsets[i] >= offsets[i - 1];
+	}
+	if(!valid) {
+		throw std::runtime_error("Invalid " + what + " offsets");
+	}
+}
+
+} // end anonymous namespace
+
+bool readInstanceCache(const std::string &cachePath, const std::string &sourcePath, RoutingInst &inst)
+{
+	if(!fileExists(cachePath)) return false;
+
+	try {
+		MappedFile file(cachePath);
+		BinaryBuffer in(file.begin(), file.end());
+
+		in.expectMagic(cacheMagic, "routing instance cache");
+		if(!(in.read<SourceStamp>() == stampOf(sourcePath))) {
+			std::cerr << "Instance cache " << cachePath << " is out of date; rebuilding it\n";
+			return false;
+		}
+
+		RoutingInst result;
+		in.read(result.gx);
+		in.read(result.gy);
+		in.read(result.cap);
+
+		// Overrides were saved in edge ID order, so finalize() has nothing to sort
+		std::vector<int> ids, caps;
+		in.read(ids);
+		in.read(caps);
+		if(ids.size() != caps.size()) {
+			throw std::runtime_error("Mismatched capacity overrides");
+		}
+		const GridGeometry grid = result.geometry();
+		for(size_t i = 0; i < ids.size(); ++i) {
+			if(!grid.isEdge(ids[i])) {
+				throw std::runtime_error("Capacity override for edge " + std::to_string(ids[i]) + ", which isn't on the grid");
+			}
+			result.edgeCaps.set(ids[i], caps[i]);
+		}
+		result.edgeCaps.finalize();
+
+		std::vector<int> netIDs;
+		std::vector<std::uint64_t> pinStart;
+		in.read(netIDs);
+		in.read(pinStart);
+		if(pinStart.size() != netIDs.size() + 1) {
+			throw std::runtime_error("Mismatched net arrays");
+		}
+
+		checkOffsets(pinStart, sizeof(Point), in, "pin");
+
+		// RoutingSolver indexes nets by ID, so they must be 0 to N-1
+		std::vector<bool> seen(netIDs.size(), false);
+		for(int id : netIDs) {
+			if(id < 0 || size_t(id) >= seen.size() || seen[id]) {
+				throw std::runtime_error("Invalid or repeated net ID " + std::to_string(id));
+			}
+			seen[id] = true;
+		}
+
+		result.nets.resize(netIDs.size());
+		for(size_t i = 0; i < netIDs.size(); ++i) {
+			Net &n = result.nets[i];
+			n.id = netIDs[i];
+			n.pins.resize(pinStart[i + 1] - pinStart[i]);
+			in.readArray(n.pins.data(), n.pins.size());
+		}
+
+		if(in.read<std::uint8_t>()) {
+			std::vector<std::uint64_t> pathStart;
+			in.read(pathStart);
+			if(pathStart.size() != netIDs.size() + 1) {
+				throw std::runtime_error("Mismatched decomposition arrays");
+			}
+
+			checkOffsets(pathStart, 2 * sizeof(Point), in, "decomposition");
+
+			result.decomposition.resize(netIDs.size());
+			for(size_t i = 0; i < netIDs.size(); ++i) {
+				auto &route = result.decomposition[i];
+				route.resize(pathStart[i + 1] - pathStart[i]);
+				for(auto &path : route) {
+					in.read(path.p1);
+					in.read(path.p2);
+				}
+			}
+		}
+
+		inst = std::move(result);
+		return true;
+	}
+	catch(std::runtime_error &e) {
+		std::cerr << "Ignoring instance cache " << cachePath << ": " << e.what() << "\n";
+		return false;
+	}
+}
+
+void writeInstanceCache(const std::string &cachePath, const std::string &sourcePath, const RoutingInst &inst)
+{
+	const std::string tmp = cachePath + ".tmp";
+	{
+		std::ofstream out(tmp, std::ios::binary);
+		if(!out) {
+			throw std::runtime_error("Couldn't open instance cache " + tmp + ": " + std::strerror(errno));
+		}
+
+		writeMagic(out, cacheMagic);
+		writeBinary(out, stampOf(sourcePath));
+		writeBinary(out, inst.gx);
+		writeBinary(out, inst.gy);
+		writeBinary(out, inst.cap);
+
+		std::vector<int> ids, caps;
+		for(const auto &o : inst.edgeCaps.entries()) {
+			ids.push_back(o.first);
+			caps.push_back(o.second);
+		}
+		writeBinary(out, ids);
+		writeBinary(out, caps);
+
+		std::vector<int> netIDs;
+		std::vector<std::uint64_t> pinStart{0};
+		for(const auto &n : inst.nets) {
+			netIDs.push_back(n.id);
+			pinStart.push_back(pinStart.back() + n.pins.size());
+		}
+		writeBinary(out, netIDs);
+		writeBinary(out, pinStart);
+		for(const auto &n : inst.nets) {
+			out.write(reinterpret_cast<const char *>(n.pins.data()), n.pins.size() * sizeof(Point));
+		}
+
+		const bool decomposed = !inst.decomposition.empty();
+		writeBinary(out, std::uint8_t(decomposed));
+		if(decomposed) {
+			std::vector<std::uint64_t> pathStart{0};
+			for(const auto &route : inst.decomposition) {
+				pathStart.push_back(pathStart.back() + route.size());
+			}
+			writeBinary(out, pathStart);
+			for(const auto &route : inst.decomposition) {
+				for(const auto &path : route) {
+					writeBinary(out, path.p1);
+					writeBinary(out, path.p2);
+				}
+			}
+		}
+
+		out.close();
+		if(!out) {
+			throw std::runtime_error("Couldn't write instance cache " + tmp);
+		}
+	}
+
+	if(std::rename(tmp.c_str(), cachePath.c_str()) != 0) {
+		throw std::runtime_error("Couldn't replace instance cache " + cachePath + ": " + std::strerror(errno));
+	}
+}
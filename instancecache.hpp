@@ -0,0 +1,27 @@
+#ifndef INSTANCECACHE_HPP_8JW2NC
+#define INSTANCECACHE_HPP_8JW2NC
+#include <string>
+
+#include "RoutingInst.hpp"
+
+/// A binary copy of a parsed routing instance, so that runs on the same
+/// benchmark after the first can skip parsing it.
+///
+/// The cache file holds the grid, capacities and capacity overrides, the
+/// pins of all nets in one flat array, and optionally the MST decomposition
+/// of every net (RoutingInst::decomposition). It records the size and
+/// modification time of the text file it was made from and is only used
+/// while they still match. Loading maps the file and copies each array out
+/// with memcpy; nothing is parsed.
+
+/// Load inst from the cache at cachePath if it was made from sourcePath as
+/// that is now. Returns false, leaving inst alone, if there is no such
+/// cache; one that is stale, damaged or from another version is reported
+/// on std::cerr and ignored too.
+bool readInstanceCache(const std::string &cachePath, const std::string &sourcePath, RoutingInst &inst);
+
+/// Save inst, read from sourcePath, to the cache at cachePath, replacing
+/// the file atomically. Throws std::runtime_error if it can't be written.
+void writeInstanceCache(const std::string &cachePath, const std::string &sourcePath, const RoutingInst &inst);
+
+#endif // INSTANCECACHE_HPP_8JW2NC
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "layoutbench.hpp"
+#include "GridGeometry.hpp"
+#include "AlignedAllocator.hpp"
+
+using namespace std;
+
+namespace {
+
+const int cacheLineBytes = 64;
+
+volatile long long sink; ///< keeps the benchmark's reads from being optimized away
+
+/// Counts last-level cache misses of this thread while alive, if the
+/// kernel lets us (containers and paranoid sysctls often don't)
+class CacheMissCounter {
+	int fd = -1;
+
+public:
+	CacheMissCounter()
+	{
+#ifdef __linux__
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		if(fd >= 0) {
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		if(fd >= 0) close(fd);
+#endif
+	}
+
+	/// Misses so far, or -1 if they can't be counted
+	long long read() const
+	{
+#ifdef __linux__
+		uint64_t count = 0;
+		if(fd >= 0 && ::read(fd, &count, sizeof(count)) == sizeof(count)) {
+			return static_cast<long long>(count);
+		}
+#endif
+		return -1;
+	}
+};
+
+struct Result {
+	double nsPerCell = 0;
+	double linesPerCell = 0;
+	long long misses = -1;
+	long long cells = 0;
+};
+
+/// The edges around one cell of the grid and how many of them exist
+struct Neighbourhood {
+	int ids[4];
+	int count = 0;
+};
+
+Neighbourhood neighbourhood(const GridGeometry &g, int x, int y)
+{
+	Neighbourhood n;
+	const auto cell = g.cellEdges(x, y);
+	if(x > 0) n.ids[n.count++] = g.edgeToward(cell, GridGeometry::West);
+	if(x < g.width - 1) n.ids[n.count++] = g.edgeToward(cell, GridGeometry::East);
+	if(y > 0) n.ids[n.count++] = g.edgeToward(cell, GridGeometry::South);
+	if(y < g.height - 1) n.ids[n.count++] = g.edgeToward(cell, GridGeometry::North);
+	return n;
+}
+
+/// Distinct cache lines of an int array spanned by n's edges
+int distinctLines(const Neighbourhood &n)
+{
+	const int perLine = cacheLineBytes / sizeof(int);
+	int lines[4];
+	int distinct = 0;
+	for(int i = 0; i < n.count; ++i) {
+		const int line = n.ids[i] / perLine;
+		bool seen = false;
+		for(int j = 0; j < distinct; ++j) seen = seen || lines[j] == line;
+		if(!seen) lines[distinct++] = line;
+	}
+	return distinct;
+}
+
+typedef vector<int, AlignedAllocator<int, cacheLineBytes>> Array;
+
+/// Visit cells in the order produced by next(x, y) (which returns false when
+/// done), reading utilization and capacity of the edges around each one
+template <typename Next>
+Result run(const GridGeometry &g, const Array &util, const Array &cap, Next next)
+{
+	Result r;
+	long long checksum = 0;
+	long long lines = 0;
+	int x, y;
+
+	CacheMissCounter misses;
+	const auto start = chrono::steady_clock::now();
+
+	while(next(x, y)) {
+		const auto n = neighbourhood(g, x, y);
+		for(int i = 0; i < n.count; ++i) {
+			checksum += util[n.ids[i]] * 3 - cap[n.ids[i]];
+		}
+		lines += distinctLines(n);
+		++r.cells;
+	}
+
+	const auto elapsed = chrono::steady_clock::now() - start;
+	r.misses = misses.read();
+	sink = checksum;
+	r.nsPerCell = chrono::duration<double, nano>(elapsed).count() / r.cells;
+	r.linesPerCell = double(lines) / r.cells;
+	return r;
+}
+
+void print(const char *layout, const char *pattern, const Result &r)
+{
+	cout << setw(10) << layout << setw(10) << pattern
+	     << setw(12) << fixed << setprecision(2) << r.nsPerCell
+	     << setw(14) << r.linesPerCell
+	     << setw(16);
+	if(r.misses >= 0) {
+		cout << r.misses << setw(14) << double(r.misses) / r.cells << "\n";
+	}
+	else {
+		cout << "n/a" << setw(14) << "n/a" << "\n";
+	}
+}
+
+} // end anonymous namespace
+
+void benchEdgeLayouts(int width, int height)
+{
+	const int windows = 20000;
+	const int windowSide = 24;
+	const long long walkSteps = 20000000;
+
+	cout << "Edge layout benchmark on a " << width << "x" << height << " grid ("
+	     << GridGeometry(width, height).numEdges() << " edges)\n"
+	     << setw(10) << "layout" << setw(10) << "pattern" << setw(12) << "ns/cell"
+	     << setw(14) << "lines/cell" << setw(16) << "cache misses" << setw(14) << "misses/cell" << "\n";
+
+	for(auto layout : {GridGeometry::RowMajor, GridGeometry::Tiled}) {
+		const GridGeometry g(width, height, layout);
+		const char *name = layout == GridGeometry::RowMajor ? "row-major" : "tiled";
+
+		Array util(g.idSpace()), cap(g.idSpace());
+		mt19937 fill(1);
+		for(int i = 0; i < g.idSpace(); ++i) {
+			util[i] = fill() % 16;
+			cap[i] = fill() % 16;
+		}
+
+		// A* expands a roughly square region around each segment; sweep
+		// windows at random positions the same for both layouts
+		{
+			mt19937 rng(2);
+			const int cellsPerWindow = windowSide * windowSide;
+			int w = 0, i = cellsPerWindow, cx = 0, cy = 0;
+			print(name, "windows", run(g, util, cap, [&](int &x, int &y) {
+				if(i == cellsPerWindow) {
+					if(w++ == windows) return false;
+					cx = rng() % max(1, width - windowSide);
+					cy = rng() % max(1, height - windowSide);
+					i = 0;
+				}
+				x = min(width - 1, cx + i % windowSide);
+				y = min(height - 1, cy + i / windowSide);
+				++i;
+				return true;
+			}));
+		}
+
+		{
+			mt19937 rng(3);
+			long long steps = walkSteps;
+			int px = width / 2, py = height / 2;
+			print(name, "walk", run(g, util, cap, [&](int &x, int &y) {
+				if(steps-- == 0) return false;
+				switch(rng() & 3) {
+					case 0: if(px > 0) --px; break;
+					case 1: if(px < width - 1) ++px; break;
+					case 2: if(py > 0) --py; break;
+					default: if(py < height - 1) ++py; break;
+				}
+				x = px;
+				y = py;
+				return true;
+			}));
+		}
+	}
+}
@@ -0,0 +1,15 @@
+/// \file
+#ifndef LAYOUTBENCH_HPP_E4PV9N
+#define LAYOUTBENCH_HPP_E4PV9N
+
+/// Compare the row-major and tiled edge ID layouts on a width by height grid.
+///
+/// Both layouts run the same two access patterns over utilization and
+/// capacity arrays indexed by edge ID: A*-style expansion of small windows
+/// (reading the four edges around every cell) and a long random walk.
+/// For each, prints the time per cell, the average number of distinct
+/// 64-byte cache lines the four edges around a cell span, and the hardware
+/// cache misses counted by perf_event_open where the kernel allows it.
+void benchEdgeLayouts(int width, int height);
+
+#endif // LAYOUTBENCH_HPP_E4PV9N
@@ -3,9 +3,16 @@
 #include "ece556.hpp"
 #include "RoutingSolver.hpp"
 #include "reader.hpp"
+#include "mappedreader.hpp"
+#include "instancecache.hpp"
 #include "writer.hpp"
 #include "colormap.hpp"
 #include "options.hpp"
+#include "layoutbench.hpp"
+#include "Portfolio.hpp"
+#include "Pipeline.hpp"
+#include "evaluator.hpp"
+#include "InterruptGuard.hpp"
 
 
 // I prefer printf to cout. It's easier to format stuff and the stream operator for cout can be weird.
@@ -13,6 +20,7 @@
 #include <iostream>
 #include <getopt.h> 
 #include <cstring>
+#include <thread>
 
 
 static bool optArgToBool(const char *name)
@@ -40,6 +48,7 @@ static Options parseOpts(int argc, char **argv)
 {
 	int ch;
 	Options result;
+	std::string portfolio; // parsed once -d and -n are known
 	opterr = 0;
 
 	option longopts[] = {
@@ -49,6 +58,36 @@ static Options parseOpts(int argc, char **argv)
 		{"depchain", required_argument, nullptr, 'c'},
 		{"emit-svg", no_argument, nullptr, 's'},
 		{"cost", required_argument, nullptr, 'c'},
+		{"edge-bits", required_argument, nullptr, 'b'},
+		{"self-test", no_argument, nullptr, 't'},
+		{"layout", required_argument, nullptr, 'l'},
+		{"bench-layout", required_argument, nullptr, 'L'},
+		{"present-factor", required_argument, nullptr, 'P'},
+		{"present-growth", required_argument, nullptr, 'G'},
+		{"history-factor", required_argument, nullptr, 'H'},
+		{"ripup", required_argument, nullptr, 'r'},
+		{"ripup-order", required_argument, nullptr, 'o'},
+		{"iteration-nets", required_argument, nullptr, 'N'},
+		{"iteration-ms", required_argument, nullptr, 'M'},
+		{"repair-margin", required_argument, nullptr, 'R'},
+		{"converge-window", required_argument, nullptr, 'w'},
+		{"converge-threshold", required_argument, nullptr, 'e'},
+		{"time-limit", required_argument, nullptr, 'T'},
+		{"checkpoint", required_argument, nullptr, 'k'},
+		{"checkpoint-every", required_argument, nullptr, 'K'},
+		{"resume", required_argument, nullptr, 'u'},
+		{"warm-start", required_argument, nullptr, 'W'},
+		{"portfolio", required_argument, nullptr, 'p'},
+		{"portfolio-cutoff", required_argument, nullptr, 'C'},
+		{"parser", required_argument, nullptr, 'i'},
+		{"parse-threads", required_argument, nullptr, 'j'},
+		{"instance-cache", required_argument, nullptr, 'I'},
+		{"merge-segments", required_argument, nullptr, 'm'},
+		{"pipeline", no_argument, nullptr, 'S'},
+		{"out-of-core", required_argument, nullptr, 'O'},
+		{"batch-nets", required_argument, nullptr, 'B'},
+		{"evaluate", no_argument, nullptr, 'E'},
+		{"evaluate-only", no_argument, nullptr, 'V'},
 		{nullptr, 0, nullptr, 0}
 	};
 
@@ -72,6 +111,98 @@ static Options parseOpts(int argc, char **argv)
 			case 'c': {
 				result.setCostFunction(optarg);
 			} break;
+			case 'b': {
+				result.setEdgeBits(optarg);
+			} break;
+			case 't': {
+				result.runSelfTest = true;
+			} break;
+			case 'l': {
+				result.setEdgeLayout(optarg);
+			} break;
+			case 'L': {
+				result.setBenchLayoutGrid(optarg);
+			} break;
+			case 'P': {
+				result.negotiation.presentFactor = std::min(NegotiatedCongestion::maxPresentFactor(),
+				                                            Options::parseFactor("--present-factor", optarg));
+			} break;
+			case 'G': {
+				result.negotiation.presentGrowth = Options::parseFactor("--present-growth", optarg);
+			} break;
+			case 'H': {
+				result.negotiation.historyFactor = Options::parseFactor("--history-factor", optarg);
+			} break;
+			case 'r': {
+				result.setRipupMode(optarg);
+			} break;
+			case 'o': {
+				result.setRipupOrder(optarg);
+			} break;
+			case 'N': {
+				result.iterationNetBudget = Options::parseCount("--iteration-nets", optarg);
+			} break;
+			case 'M': {
+				result.iterationTimeBudget = Options::parseCount("--iteration-ms", optarg);
+			} break;
+			case 'R': {
+				result.repairMargin = Options::parseCount("--repair-margin", optarg);
+			} break;
+			case 'w': {
+				result.convergenceWindow = Options::parseCount("--converge-window", optarg);
+			} break;
+			case 'e': {
+				result.convergenceThreshold = Options::parseFactor("--converge-threshold", optarg);
+			} break;
+			case 'T': {
+				result.timeLimit = Options::parseCount("--time-limit", optarg);
+			} break;
+			case 'k': {
+				result.checkpointFile = optarg;
+			} break;
+			case 'K': {
+				result.checkpointInterval = Options::parseCount("--checkpoint-every", optarg);
+			} break;
+			case 'u': {
+				result.resumeFile = optarg;
+			} break;
+			case 'W': {
+				result.warmStartFile = optarg;
+			} break;
+			case 'p': {
+				portfolio = optarg;
+			} break;
+			case 'C': {
+				result.portfolioCutoff = Options::parseFactor("--portfolio-cutoff", optarg);
+			} break;
+			case 'i': {
+				result.setInputParser(optarg);
+			} break;
+			case 'j': {
+				result.parseThreads = Options::parseCount("--parse-threads", optarg);
+			} break;
+			case 'I': {
+				result.instanceCache = optarg;
+			} break;
+			case 'm': {
+				result.mergeSegments = optArgToBool("--merge-segments");
+			} break;
+			case 'S': {
+				result.pipeline = true;
+			} break;
+			case 'O': {
+				result.outOfCore = optarg;
+				result.pipeline = true;
+			} break;
+			case 'B': {
+				result.outOfCoreBatch = std::max(1, Options::parseCount("--batch-nets", optarg));
+			} break;
+			case 'E': {
+				result.evaluate = true;
+			} break;
+			case 'V': {
+				result.evaluateOnly = true;
+			} break;
 			case ':': break;
 			default: {
 				std::cerr << "Unrecognized option: " << char(ch) << "\n";
@@ -83,7 +214,40 @@ static Options parseOpts(int argc, char **argv)
 	int remainingArgCount = argc - optind;
 	char **remainingArgs = argv + optind;
 
-	if(remainingArgCount != 2) {
+	if(!result.resumeFile.empty() && !result.warmStartFile.empty()) {
+		std::cerr << "--resume and --warm-start can't be combined\n";
+		usage(argc, argv);
+	}
+
+	if(!portfolio.empty()) {
+		result.setPortfolio(portfolio);
+		if(!result.resumeFile.empty() || !result.warmStartFile.empty() || !result.checkpointFile.empty()) {
+			std::cerr << "--portfolio can't be combined with --resume, --warm-start or --checkpoint\n";
+			usage(argc, argv);
+		}
+	}
+
+	if(result.pipeline && (result.inputParser != Options::MappedParser || !result.instanceCache.empty() ||
+	                       !result.portfolio.empty() || !result.resumeFile.empty() || !result.warmStartFile.empty())) {
+		std::cerr << "--pipeline needs --parser mmap and can't be combined with --instance-cache, "
+		             "--portfolio, --resume or --warm-start\n";
+		usage(argc, argv);
+	}
+
+	if(!result.outOfCore.empty() && (!result.checkpointFile.empty() || result.evaluate)) {
+		std::cerr << "--out-of-core can't be combined with --checkpoint or --evaluate\n";
+		usage(argc, argv);
+	}
+
+	if(result.evaluateOnly && result.pipeline) {
+		std::cerr << "--evaluate-only can't be combined with --pipeline or --out-of-core\n";
+		usage(argc, argv);
+	}
+
+	if(result.runSelfTest || result.benchLayoutWidth > 0) {
+		return result;
+	}
+	else if(remainingArgCount != 2) {
 		usage(argc, argv);
 	}
 	else {
@@ -109,10 +273,9 @@ static void testReadingInput()
 			}
 		}
 
-		int i = 0;
-		for(int cap : inst.edgeCaps) {
-			std::cout << "-> edge " << i << " cap " << cap << "\n";
-			++i;
+		std::cout << "default edge cap " << inst.cap << "\n";
+		for(const auto &o : inst.edgeCaps.entries()) {
+			std::cout << "-> edge " << o.first << " cap " << o.second << "\n";
 		}
 	}
 	catch(std::exception &exc) {
@@ -128,8 +291,14 @@ std::string strerrno()
 }
 
 
-RoutingInst readRoutingInstFromPath(const std::string &path)
+RoutingInst readRoutingInstFromPath(const std::string &path, const Options &opts)
 {
+	if(opts.inputParser == Options::MappedParser)
+	{
+		const unsigned threads = opts.parseThreads > 0 ? opts.parseThreads : std::thread::hardware_concurrency();
+		return readRoutingInstMapped(path, std::max(1u, threads));
+	}
+
 	std::ifstream in(path);
 	if(!in)
 	{
@@ -138,7 +307,8 @@ RoutingInst readRoutingInstFromPath(const std::string &path)
 	return readRoutingInst(in);
 }
 
-void writeToPath(const std::string &path, const RoutingInst &inst)
+void writeToPath(const std::string &path, const RoutingInst &inst, bool mergeSegments,
+                 const NetStore *spilled = nullptr, size_t batchSize = 0)
 {
 	std::ofstream out(path);
 	if(!out)
@@ -146,7 +316,19 @@ void writeToPath(const std::string &path, const RoutingInst &inst)
 		throw std::runtime_error("Couldn't open output file: " + strerrno());
 	}
 
-	write(out, inst);
+	if(spilled) {
+		// a batch at a time, in ID order
+		FastWriter writer(out, inst, mergeSegments);
+		std::vector<Net> batch;
+		for(size_t first = 0; first < spilled->size(); first += batchSize) {
+			batch.resize(std::min(batchSize, spilled->size() - first));
+			for(size_t i = 0; i < batch.size(); ++i) spilled->get(first + i, batch[i]);
+			writer.writeNets(batch);
+		}
+	}
+	else {
+		writeFast(out, inst, mergeSegments);
+	}
 
 	out.close();
 
@@ -156,6 +338,17 @@ void writeToPath(const std::string &path, const RoutingInst &inst)
 	}
 }
 
+/// Score the solution at solutionPath for --evaluate-only
+Evaluation evaluateFile(const std::string &solutionPath, const RoutingInst &inst)
+{
+	std::ifstream in(solutionPath);
+	if(!in)
+	{
+		throw std::runtime_error("Couldn't open solution " + solutionPath + ": " + strerrno());
+	}
+	return evaluate(inst, readSolution(in));
+}
+
 } // end anonymous namespace
 
 
@@ -165,29 +358,118 @@ int main(int argc, char** argv)
 
  	// read benchmark
 	try {
+		const auto programStart = std::chrono::steady_clock::now();
 		auto opts = parseOpts(argc, argv);
-		auto problem = readRoutingInstFromPath(opts.inputBenchmark);
-		RoutingSolver rst(problem);
+		if(opts.runSelfTest) {
+			testEdgeID();
+			testMappedReader();
+			testEdgeState();
+			return 0;
+		}
+		if(opts.benchLayoutWidth > 0) {
+			benchEdgeLayouts(opts.benchLayoutWidth, opts.benchLayoutHeight);
+			return 0;
+		}
 
-		rst.useNetDecomposition = opts.useNetDecomposition;
-		rst.useNetOrdering = opts.useNetOrdering;
-		rst.timeLimit = std::chrono::minutes(13);
-		rst.emitSVG = opts.emitSVG;
-		rst.costFunction = opts.costFunction;
+		const auto readStart = std::chrono::steady_clock::now();
+		auto msSinceRead = [&]() {
+			return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - readStart).count();
+		};
+
+		RoutingInst problem;
+		std::unique_ptr<MappedFile> streamedFile; // input still to be read, with --pipeline
+		std::unique_ptr<MappedReader> streamedReader;
+		std::unique_ptr<NetStore> spilled; // routed nets, with --out-of-core
+		if(opts.pipeline) {
+			streamedFile.reset(new MappedFile(opts.inputBenchmark));
+			streamedReader.reset(new MappedReader(streamedFile->begin(), streamedFile->end()));
+			const int netCount = streamedReader->readHeader(problem);
+			if(!opts.outOfCore.empty()) {
+				spilled.reset(new NetStore(opts.outOfCore, netCount));
+			}
+			else {
+				problem.nets.resize(netCount);
+				for(size_t i = 0; i < problem.nets.size(); ++i) problem.nets[i].id = i;
+			}
+			printf("Read the header for %d nets; reading them while routing\n", netCount);
+		}
+		else if(!opts.instanceCache.empty() && readInstanceCache(opts.instanceCache, opts.inputBenchmark, problem)) {
+			printf("Loaded %zu nets from cache %s in %lld ms\n", problem.nets.size(), opts.instanceCache.c_str(), msSinceRead());
+		}
+		else {
+			problem = readRoutingInstFromPath(opts.inputBenchmark, opts);
+			printf("Read %zu nets in %lld ms\n", problem.nets.size(), msSinceRead());
+
+			if(!opts.instanceCache.empty()) {
+				if(opts.useNetDecomposition) {
+					// precompute the decomposition for later runs (and this one)
+					std::vector<Net> decomposed = problem.nets;
+					decomposeNets(decomposed, true);
+					problem.decomposition.resize(decomposed.size());
+					for(auto &n : decomposed) problem.decomposition.at(n.id) = std::move(n.nroute);
+				}
+				writeInstanceCache(opts.instanceCache, opts.inputBenchmark, problem);
+				printf("Saved instance cache %s\n", opts.instanceCache.c_str());
+			}
+		}
+		if(opts.evaluateOnly) {
+			std::cout << evaluateFile(opts.outputFile, problem) << std::endl;
+			return 0;
+		}
 
-		if (opts.useNetOrdering)
-			rst.reorderNets(problem.nets);
-		else
-			printf("Not using ordering\n");
+		problem.setLayout(opts.edgeLayout);
+		auto deadline = std::chrono::steady_clock::time_point::max();
+		if(opts.timeLimit > 0)
+			deadline = programStart + std::chrono::seconds(opts.timeLimit);
 
-		// run actual routing
-		rst.solveRouting();
+		if(!opts.portfolio.empty()) {
+			problem.nets = runPortfolio(problem, opts, deadline);
+		}
+		else {
+			RoutingSolver rst(problem);
+			rst.applyOptions(opts);
+			rst.deadline = deadline;
+
+			if(!opts.resumeFile.empty()) {
+				rst.resumeFromCheckpoint(opts.resumeFile);
+				printf("Resuming from checkpoint %s\n", opts.resumeFile.c_str());
+			}
+			else if(streamedReader) {
+				// nets are routed in input order, as they arrive
+				solveRoutingPipelined(*streamedReader, problem, rst, spilled.get());
+			}
+			else {
+				if (opts.useNetOrdering)
+					rst.reorderNets(problem.nets);
+				else
+					printf("Not using ordering\n");
+
+				// run actual routing, or pick up a previous run's result
+				if(!opts.warmStartFile.empty())
+					rst.warmStart(opts.warmStartFile);
+				else
+					rst.solveRouting();
+			}
 
-		if(opts.useNetOrdering || opts.useNetDecomposition)
-			rst.rrr();
+			InterruptGuard interruptible; // ^C stops RRR gracefully
+			if(opts.useNetOrdering || opts.useNetDecomposition) {
+				if(spilled)
+					rst.rrrOutOfCore(*spilled, opts.outOfCoreBatch);
+				else
+					rst.rrr();
+			}
+		}
+
+		if(opts.evaluate) {
+			const auto evaluationStart = std::chrono::steady_clock::now();
+			const Evaluation score = evaluate(problem);
+			std::cout << "Evaluation: " << score << " ("
+			          << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - evaluationStart).count()
+			          << " ms)" << std::endl;
+		}
 
 		// write the result
-		writeToPath(opts.outputFile, problem);
+		writeToPath(opts.outputFile, problem, opts.mergeSegments, spilled.get(), opts.outOfCoreBatch);
 		return 0;
 	}
 	catch (std::exception& ex) {
@@ -0,0 +1,487 @@
+#include "mappedreader.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path)
+: data(nullptr)
+, size(0)
+, mapped(false)
+{
+	const int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		throw std::runtime_error("Couldn't open file: " + std::string(std::strerror(errno)));
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p != MAP_FAILED) {
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			data = static_cast<const char *>(p);
+			size = st.st_size;
+			mapped = true;
+		}
+	}
+	close(fd);
+
+	if(!mapped) {
+		std::ifstream in(path, std::ios::binary);
+		std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+		if(in.bad()) {
+			throw std::runtime_error("Couldn't read file: " + std::string(std::strerror(errno)));
+		}
+		char *copy = new char[contents.size()];
+		std::memcpy(copy, contents.data(), contents.size());
+		data = copy;
+		size = contents.size();
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if(mapped) {
+		munmap(const_cast<char *>(data), size);
+	}
+	else {
+		delete[] data;
+	}
+}
+
+namespace {
+
+bool isSpace(char c)
+{
+	return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+bool tokenIs(const char *begin, const char *end, const char *keyword)
+{
+	const size_t n = std::strlen(keyword);
+	return size_t(end - begin) == n && std::memcmp(begin, keyword, n) == 0;
+}
+
+} // end anonymous namespace
+
+void MappedReader::skipSpace()
+{
+	while(pos != end && isSpace(*pos)) {
+		if(*pos == '\n') {
+			lineNum++;
+		}
+		++pos;
+	}
+}
+
+bool MappedReader::scanInt(const char *begin, int &value) const
+{
+	if(begin == tokenEnd) return false;
+
+	long long result = 0;
+	for(const char *p = begin; p != tokenEnd; ++p) {
+		if(!isDigit(*p)) return false;
+		result = result * 10 + (*p - '0');
+		if(result > std::numeric_limits<int>::max()) return false;
+	}
+	value = int(result);
+	return true;
+}
+
+void MappedReader::readNextToken()
+{
+	if(putback) {
+		putback = false;
+		return;
+	}
+
+	skipSpace();
+
+	tokenType = Reader::TInvalid;
+	tokenBegin = pos;
+	while(pos != end && !isSpace(*pos)) ++pos;
+	tokenEnd = pos;
+
+	if(tokenBegin != tokenEnd) {
+		if(isDigit(*tokenBegin)) {
+			if(!scanInt(tokenBegin, intValue)) {
+				fail("Invalid integer: '" + std::string(tokenBegin, tokenEnd) + "'");
+			}
+			tokenType = Reader::TInteger;
+		}
+		else if(tokenIs(tokenBegin, tokenEnd, "grid")) {
+			tokenType = Reader::KWGrid;
+		}
+		else if(tokenIs(tokenBegin, tokenEnd, "capacity")) {
+			tokenType = Reader::KWCapacity;
+		}
+		else if(tokenIs(tokenBegin, tokenEnd, "num")) {
+			tokenType = Reader::KWNum;
+		}
+		else if(tokenIs(tokenBegin, tokenEnd, "net")) {
+			tokenType = Reader::KWNet;
+		}
+		else if(*tokenBegin == 'n') {
+			tokenType = Reader::TNetName;
+			if(!scanInt(tokenBegin + 1, intValue)) {
+				fail("Invalid net name: '" + std::string(tokenBegin, tokenEnd) + "'");
+			}
+		}
+		else {
+			unexpected();
+		}
+	}
+
+	skipSpace();
+}
+
+void MappedReader::unexpected()
+{
+	if(tokenType == Reader::TInvalid) fail("Unexpected EOF");
+	fail("Unexpected token: '" + std::string(tokenBegin, tokenEnd) + "'.");
+}
+
+void MappedReader::expect(TokenType ty)
+{
+	readNextToken();
+	if(tokenType != ty) unexpected();
+}
+
+void MappedReader::fail(const std::string &msg)
+{
+	std::stringstream s;
+	s << "Line " << lineNum << ": " << msg;
+	throw ParseError(s.str());
+}
+
+Point MappedReader::readPoint()
+{
+	Point result;
+
+	expect(Reader::TInteger);
+	result.x = intValue;
+
+	expect(Reader::TInteger);
+	result.y = intValue;
+
+	return result;
+}
+
+void MappedReader::readNet(Net &result)
+{
+	expect(Reader::TNetName);
+	result.id = intValue;
+
+	expect(Reader::TInteger);
+	const int pinCount = intValue;
+
+	result.pins.reserve(std::min<size_t>(pinCount, mostFitting(minPointBytes)));
+	for(int i = 0; i < pinCount; ++i) {
+		result.pins.push_back(readPoint());
+	}
+}
+
+RoutingInst MappedReader::readRoutingInst()
+{
+	RoutingInst result;
+	readNextToken();
+
+	bool readHdr = false;
+	int netCount = 0;
+
+	while(tokenType != Reader::TInvalid) {
+		switch(tokenType) {
+			case Reader::KWGrid:
+				expect(Reader::TInteger);
+				result.gx = intValue;
+				expect(Reader::TInteger);
+				result.gy = intValue;
+				break;
+
+			case Reader::KWCapacity:
+				expect(Reader::TInteger);
+				result.cap = intValue;
+				break;
+
+			case Reader::KWNum:
+				readHdr = true;
+				expect(Reader::KWNet);
+				expect(Reader::TInteger);
+				netCount = intValue;
+				// Net slots are preallocated, so more nets than the input can
+				// hold are left to the sequential loop to report
+				if(threads > 1 && result.nets.empty() && size_t(netCount) <= mostFitting(minNetBytes)) {
+					readNetsParallel(result.nets, netCount);
+					break;
+				}
+				result.nets.reserve(result.nets.size() + std::min<size_t>(netCount, mostFitting(minNetBytes)));
+				for(int i = 0; i < netCount; ++i) {
+					result.nets.emplace_back();
+					readNet(result.nets.back());
+				}
+				break;
+
+			case Reader::TInteger: {
+				if(!readHdr) {
+					fail("Unexpected integer.");
+				}
+
+				readBlockages(result, intValue);
+			} break;
+			default:
+				unexpected();
+		}
+		readNextToken();
+	}
+
+	result.edgeCaps.finalize();
+	return result;
+}
+
+void MappedReader::readBlockages(RoutingInst &result, int nBlockages)
+{
+	const GridGeometry grid = result.geometry();
+
+	for(int i = 0; i < nBlockages; ++i) {
+		Point p1 = readPoint();
+		Point p2 = readPoint();
+		if(!grid.isUnitEdge(p1, p2)) fail("Blockage is not an edge of the grid.");
+		expect(Reader::TInteger);
+		int capacity = intValue;
+		result.setEdgeCap(p1, p2, capacity);
+	}
+}
+
+int MappedReader::readHeader(RoutingInst &result)
+{
+	for(;;) {
+		readNextToken();
+		switch(tokenType) {
+			case Reader::KWGrid:
+				expect(Reader::TInteger);
+				result.gx = intValue;
+				expect(Reader::TInteger);
+				result.gy = intValue;
+				break;
+
+			case Reader::KWCapacity:
+				expect(Reader::TInteger);
+				result.cap = intValue;
+				break;
+
+			case Reader::KWNum:
+				expect(Reader::KWNet);
+				expect(Reader::TInteger);
+				if(size_t(intValue) > mostFitting(minNetBytes)) {
+					fail("Expected " + std::to_string(intValue) + " nets, more than the rest of the input can hold.");
+				}
+				return intValue;
+
+			default:
+				unexpected();
+		}
+	}
+}
+
+void MappedReader::readTrailer(RoutingInst &result)
+{
+	for(readNextToken(); tokenType != Reader::TInvalid; readNextToken()) {
+		if(tokenType != Reader::TInteger) unexpected();
+		readBlockages(result, intValue);
+	}
+
+	result.edgeCaps.finalize();
+}
+
+int MappedReader::readNetChunk(const char *stop, std::vector<Net> &nets, std::atomic<bool> *claimed)
+{
+	int count = 0;
+	Net net;
+
+	while(pos < stop && *pos == 'n') {
+		readNet(net);
+		if(net.id < 0 || size_t(net.id) >= nets.size()) {
+			fail("Net ID out of range: n" + std::to_string(net.id));
+		}
+		if(claimed[net.id].exchange(true)) {
+			fail("Repeated net: n" + std::to_string(net.id));
+		}
+		nets[net.id] = std::move(net);
+		net = Net();
+		++count;
+	}
+
+	return count;
+}
+
+void MappedReader::readNetsParallel(std::vector<Net> &nets, int netCount)
+{
+	// pos is at the first net's name (or whatever follows the header)
+	const char *section = pos;
+	const size_t chunks = std::max<size_t>(1, std::min<size_t>(threads, (end - section) / minChunkBytes));
+
+	// Split at the start of the first net name after every chunk's share of
+	// the bytes. Where the net section ends isn't known yet, so a split may
+	// fall among the blockages, where nothing starts with 'n'; it then runs
+	// to the end and its chunk reads nothing.
+	std::vector<const char *> splits{section};
+	std::vector<int> lines{lineNum};
+	for(size_t i = 1; i < chunks; ++i) {
+		const char *p = std::max(splits.back(), section + (end - section) * i / chunks);
+		while(p != end && !(*p == 'n' && isSpace(p[-1]))) ++p;
+		lines.push_back(lines.back() + int(std::count(splits.back(), p, '\n')));
+		splits.push_back(p);
+	}
+	splits.push_back(end);
+
+	nets.resize(netCount);
+	std::unique_ptr<std::atomic<bool>[]> claimed(new std::atomic<bool>[netCount]());
+
+	// Each chunk gets its own reader, which stops at its split or at the
+	// first token that isn't a net name
+	std::vector<MappedReader> readers;
+	for(size_t i = 0; i < chunks; ++i) {
+		readers.emplace_back(splits[i], end);
+		readers.back().lineNum = lines[i];
+	}
+
+	std::vector<std::future<int>> futures;
+	for(size_t i = 0; i < chunks; ++i) {
+		futures.push_back(std::async(std::launch::async, [&, i] {
+			return readers[i].readNetChunk(splits[i + 1], nets, claimed.get());
+		}));
+	}
+
+	// Wait for every chunk. The net section ends in the first one that
+	// stopped short of its split; errors before that point come first.
+	for(auto &f : futures) f.wait();
+	int found = 0;
+	size_t last = 0;
+	for(;; ++last) {
+		found += futures[last].get();
+		if(last + 1 == chunks || readers[last].pos != splits[last + 1]) break;
+	}
+
+	pos = readers[last].pos;
+	lineNum = readers[last].lineNum;
+
+	// Chunks after it must have found nothing, or the nets were interrupted
+	// by something else, which is where the error is
+	for(size_t i = last + 1; i < chunks; ++i) {
+		bool readNets;
+		try {
+			readNets = futures[i].get() > 0;
+		}
+		catch(const ParseError &) {
+			readNets = true;
+		}
+		if(readNets) {
+			readNextToken();
+			unexpected();
+		}
+	}
+
+	if(found != netCount) {
+		fail("Expected " + std::to_string(netCount) + " nets, found " + std::to_string(found) + ".");
+	}
+}
+
+namespace {
+
+/// A valid instance with nets 0 to netCount-1 of two to five pins, and
+/// blockages on every other edge up to blockages of them
+std::string testInstance(int width, int height, int netCount, int blockages)
+{
+	const GridGeometry grid(width, height);
+	unsigned state = 12345;
+	auto next = [&](int n) {
+		state = state * 1103515245u + 12345u;
+		return int((state >> 8) % unsigned(n));
+	};
+
+	std::ostringstream text;
+	text << "grid " << width << " " << height << "\ncapacity 10\nnum net " << netCount << "\n";
+	for(int id = 0; id < netCount; ++id) {
+		const int pins = 2 + next(4);
+		text << "n" << id << " " << pins << "\n";
+		for(int i = 0; i < pins; ++i) {
+			text << next(width) << " " << next(height) << "\n";
+		}
+	}
+
+	blockages = std::min(blockages, (grid.numEdges() + 1) / 2);
+	text << blockages << "\n";
+	for(int i = 0; i < blockages; ++i) {
+		const Edge e = grid.edge(2 * i);
+		text << e.p1.x << " " << e.p1.y << " " << e.p2.x << " " << e.p2.y << " " << next(10) << "\n";
+	}
+	return text.str();
+}
+
+void check(bool ok, const std::string &name, unsigned threads, const std::string &what)
+{
+	if(!ok) {
+		std::stringstream ss;
+		ss << "parser test failed on " << name << " with " << threads << " threads: " << what;
+		throw std::logic_error(ss.str());
+	}
+}
+
+} // end anonymous namespace
+
+void testMappedReader()
+{
+	struct Case {
+		const char *name;
+		int width, height, nets, blockages;
+	};
+	// Blockages taking most of the file put the split points among them
+	const Case cases[] = {
+		{"few blockages", 100, 100, 40000, 10},
+		{"many blockages", 300, 300, 2000, 60000},
+		{"no nets", 300, 300, 0, 60000},
+	};
+
+	for(const auto &c : cases) {
+		const std::string text = testInstance(c.width, c.height, c.nets, c.blockages);
+		std::istringstream in(text);
+		const RoutingInst expected = readRoutingInst(in);
+
+		for(unsigned threads : {1u, 2u, 4u, 8u}) {
+			RoutingInst inst;
+			try {
+				inst = MappedReader(text.data(), text.data() + text.size(), threads).readRoutingInst();
+			}
+			catch(const ParseError &e) {
+				check(false, c.name, threads, e.what());
+			}
+
+			check(inst.gx == expected.gx && inst.gy == expected.gy && inst.cap == expected.cap, c.name, threads, "header");
+			check(inst.nets.size() == expected.nets.size(), c.name, threads, "net count");
+			for(size_t i = 0; i < inst.nets.size(); ++i) {
+				check(inst.nets[i].id == expected.nets[i].id && inst.nets[i].pins == expected.nets[i].pins,
+				      c.name, threads, "net n" + std::to_string(expected.nets[i].id));
+			}
+			check(inst.edgeCaps.entries() == expected.edgeCaps.entries(), c.name, threads, "blockages");
+		}
+
+		std::cout << c.name << ": " << text.size() << " bytes, " << c.nets << " nets, "
+		          << expected.edgeCaps.entries().size() << " blockages OK\n";
+	}
+}
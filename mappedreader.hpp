@@ -0,0 +1,114 @@
+#ifndef MAPPEDREADER_HPP_4PZ8QK
+#define MAPPEDREADER_HPP_4PZ8QK
+#include <atomic>
+#include <string>
+
+#include "RoutingInst.hpp"
+#include "reader.hpp"
+
+/// A file mapped read-only into memory, or read into a buffer if it can't
+/// be mapped (such as a pipe). Throws std::runtime_error if it can't be read.
+class MappedFile {
+	const char *data;
+	size_t size;
+	bool mapped;     ///< whether data must be unmapped rather than deleted
+public:
+	explicit MappedFile(const std::string &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	const char *begin() const { return data; }
+	const char *end() const { return data + size; }
+};
+
+/// Reads a routing instance from text in memory, accepting the same input
+/// and giving the same line-numbered ParseErrors as Reader. Tokens are
+/// scanned in place and integers converted by hand, so nothing is allocated
+/// per token. (use once, then discard)
+class MappedReader {
+	typedef Reader::TokenType TokenType;
+
+	const char *pos;        ///< next character to scan
+	const char *end;
+	const char *tokenBegin; ///< text of the last read token
+	const char *tokenEnd;
+	TokenType tokenType;    ///< token type of last read token
+	bool putback;
+	int intValue;           ///< integer value of last read token (if applicable)
+	int lineNum;            ///< current line number
+	unsigned threads;       ///< most threads parsing the net section
+
+	void skipSpace(); ///< Skip whitespace, incrementing line number if appropriate
+	void readNextToken(); ///< Read a token if !putback, otherwise set putback=false
+	void expect(TokenType); ///< Expect a token of the given type
+	void unexpected(); ///< Throw an "unexpected token" error
+	bool scanInt(const char *begin, int &value) const; ///< Convert [begin, tokenEnd) if it is all digits and fits
+
+	void fail(const std::string &msg); ///< Throw an error with the current line number
+
+	Point readPoint();
+	void readBlockages(RoutingInst &, int count);
+
+	static const size_t minPointBytes = 4; ///< "0 0" and a separator
+	static const size_t minNetBytes = 5;   ///< "n0 0" and a separator
+
+	/// Most items of at least itemBytes each, the last one without its
+	/// separator, that the rest of the input can hold. Counts read from the
+	/// input are only trusted this far when sizing anything, so a bogus count
+	/// fails on the token where the items run out, as in Reader, rather than
+	/// allocating for it.
+	size_t mostFitting(size_t itemBytes) const { return (end - pos + 1) / itemBytes; }
+
+	/// Read the netCount nets following the `num net` header into nets,
+	/// splitting them between threads (see the class comment)
+	void readNetsParallel(std::vector<Net> &nets, int netCount);
+
+	/// Read nets from pos into their slots in nets until pos reaches stop
+	/// or the next token isn't a net name. Returns how many were read.
+	int readNetChunk(const char *stop, std::vector<Net> &nets, std::atomic<bool> *claimed);
+public:
+	/// With threads > 1, the net section is split at net names into chunks
+	/// of at least minChunkBytes that are parsed concurrently, each net going
+	/// into the slot of its ID. Net IDs then have to be 0 to N-1 for N nets,
+	/// in any order, as RoutingSolver requires anyway.
+	MappedReader(const char *begin, const char *end, unsigned threads = 1)
+	: pos(begin)
+	, end(end)
+	, tokenBegin(begin)
+	, tokenEnd(begin)
+	, tokenType(Reader::TInvalid)
+	, putback(false)
+	, intValue(0)
+	, lineNum(1)
+	, threads(threads)
+	{ }
+
+	static const size_t minChunkBytes = 1 << 18;
+
+	RoutingInst readRoutingInst();
+
+	/// For reading an instance a piece at a time, in the usual order: read
+	/// the grid and capacity into result up to the `num net N` header and
+	/// return N, then call readNet() N times, then readTrailer() for the
+	/// capacity overrides. Fails if the rest of the input can't hold N nets.
+	int readHeader(RoutingInst &result);
+	void readNet(Net &);
+	void readTrailer(RoutingInst &result);
+};
+
+/// Convenience API for MappedFile and MappedReader
+inline RoutingInst readRoutingInstMapped(const std::string &path, unsigned threads = 1)
+{
+	MappedFile file(path);
+	return MappedReader(file.begin(), file.end(), threads).readRoutingInst();
+}
+
+/// Parse generated instances with MappedReader on 1 to 8 threads and check
+/// they come out as Reader reads them, including instances whose blockages
+/// are long enough for net section split points to fall among them.
+/// Throws std::logic_error describing the first mismatch.
+void testMappedReader();
+
+#endif // MAPPEDREADER_HPP_4PZ8QK
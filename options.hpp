@@ -3,8 +3,13 @@
 #ifndef OPTIONS_HPP_GY8LUN
 #define OPTIONS_HPP_GY8LUN
 
+#include <cmath>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
+#include "GridGeometry.hpp"
+#include "NegotiatedCongestion.hpp"
 
 struct Options {
 	std::string inputBenchmark, outputFile;
@@ -12,27 +17,284 @@ struct Options {
 	bool useNetDecomposition = true;
 	bool useNetOrdering = true;
 	bool emitSVG = false;
+	bool runSelfTest = false;
+	int benchLayoutWidth = 0, benchLayoutHeight = 0; ///< grid for --bench-layout, if given
         bool findDependencyChains = false;
 	
 	enum CostFunction {
-		Standard, NC
+		Standard, NC, PathFinder
 	};
 	
 	CostFunction costFunction = Standard;
+
+	/// What rip-up and reroute tears up when a net crosses an overflowed edge
+	enum RipupMode {
+		RipNets,     ///< the whole net, which is decomposed and routed again
+		RipSegments, ///< only the net's paths that cross an overflowed edge
+		RepairPaths  ///< only the overflowed stretch of each such path, if it
+		             ///< can be detoured nearby; otherwise the whole path
+	};
+
+	RipupMode ripupMode = RipNets;
+
+	void setRipupMode(const std::string &s)
+	{
+		if(s.empty() || s == "net") {
+			ripupMode = RipNets;
+		}
+		else if(s == "segment") {
+			ripupMode = RipSegments;
+		}
+		else if(s == "repair") {
+			ripupMode = RepairPaths;
+		}
+		else {
+			throw std::runtime_error("Unknown rip-up mode " + s + ". Options are 'net', 'segment', 'repair'.");
+		}
+	}
+
+	/// How many cells around an overflowed stretch a repair may detour through
+	int repairMargin = 3;
+
+	/// Reroute nets in order of how much they contribute to the total
+	/// overflow instead of in net order
+	bool ripupByOverflow = false;
+
+	/// Most nets rerouted in one RRR iteration, or 0 for no limit
+	int iterationNetBudget = 0;
+
+	/// Most milliseconds spent rerouting in one RRR iteration, or 0 for no limit
+	int iterationTimeBudget = 0;
+
+	void setRipupOrder(const std::string &s)
+	{
+		if(s.empty() || s == "net") {
+			ripupByOverflow = false;
+		}
+		else if(s == "overflow") {
+			ripupByOverflow = true;
+		}
+		else {
+			throw std::runtime_error("Unknown rip-up order " + s + ". Options are 'net', 'overflow'.");
+		}
+	}
+
+	/// Parse a nonnegative count given to the command line option `name`
+	static int parseCount(const std::string &name, const std::string &s)
+	{
+		std::istringstream in(s);
+		int result;
+		if(!(in >> result) || !in.eof() || result < 0) {
+			throw std::runtime_error("Expected a nonnegative integer for " + name + ", not " + s);
+		}
+		return result;
+	}
+
+	/// File to save RRR checkpoints to (none if empty), and seconds between them
+	std::string checkpointFile;
+	int checkpointInterval = 60;
+
+	/// Checkpoint to continue RRR from instead of building an initial solution
+	std::string resumeFile;
+
+	/// Routing solution (Writer output) to start RRR from instead of solveRouting()
+	std::string warmStartFile;
+
+	/// Seconds from startup until rip-up and reroute must stop, or 0 for no limit
+	int timeLimit = 13 * 60;
+
+	/// RRR stops once total overflow (or wirelength, once there is no
+	/// overflow) improved by less than convergenceThreshold, relatively,
+	/// over the last convergenceWindow iterations. A window of 0 never stops.
+	int convergenceWindow = 25;
+	double convergenceThreshold = 0.005;
+
+	/// Initial cost factors and growth rate of the PathFinder cost function
+	NegotiatedCongestion negotiation;
+
+	/// Parse a finite, nonnegative factor given to the command line option `name`
+	static double parseFactor(const std::string &name, const std::string &s)
+	{
+		std::istringstream in(s);
+		double result;
+		if(!(in >> result) || !in.eof() || !std::isfinite(result) || result < 0) {
+			throw std::runtime_error("Expected a finite nonnegative number for " + name + ", not " + s);
+		}
+		return result;
+	}
+
+	/// How the input benchmark is read
+	enum InputParser {
+		StreamParser, ///< Reader, token by token from a std::istream
+		MappedParser  ///< MappedReader, over the file mapped into memory
+	};
+
+	InputParser inputParser = MappedParser;
+
+	/// Threads MappedParser splits the net section between, or 0 for one per core
+	int parseThreads = 0;
+
+	/// Write each net's edges as maximal straight segments rather than one
+	/// line per unit edge
+	bool mergeSegments = true;
+
+	/// Decompose and route nets while the rest of the input is still being
+	/// read (see solveRoutingPipelined)
+	bool pipeline = false;
+
+	/// Prefix of the files routed nets are kept in instead of memory (see
+	/// NetStore and RoutingSolver::rrrOutOfCore), or empty to keep them in
+	/// memory. Implies pipeline.
+	std::string outOfCore;
+
+	/// Nets held in memory at a time in out-of-core rip-up and reroute and
+	/// when writing the result
+	int outOfCoreBatch = 65536;
+
+	/// Print the solution's overflow, wirelength and invalid nets once
+	/// routing is done (see evaluate())
+	bool evaluate = false;
+
+	/// Instead of routing, score the existing solution outputFile against
+	/// inputBenchmark
+	bool evaluateOnly = false;
+
+	/// Binary copy of the input benchmark to load instead of parsing it, or
+	/// to create if it is missing or out of date (none if empty)
+	std::string instanceCache;
+
+	void setInputParser(const std::string &s)
+	{
+		if(s.empty() || s == "mmap") {
+			inputParser = MappedParser;
+		}
+		else if(s == "stream") {
+			inputParser = StreamParser;
+		}
+		else {
+			throw std::runtime_error("Unknown parser " + s + ". Options are 'mmap', 'stream'.");
+		}
+	}
+
+	GridGeometry::Layout edgeLayout = GridGeometry::RowMajor;
+
+	void setEdgeLayout(const std::string &s)
+	{
+		if(s.empty() || s == "rowmajor") {
+			edgeLayout = GridGeometry::RowMajor;
+		}
+		else if(s == "tiled") {
+			edgeLayout = GridGeometry::Tiled;
+		}
+		else {
+			throw std::runtime_error("Unknown edge layout " + s + ". Options are 'rowmajor', 'tiled'.");
+		}
+	}
+
+	void setBenchLayoutGrid(const std::string &s)
+	{
+		char x;
+		std::istringstream in(s);
+		if(!(in >> benchLayoutWidth >> x >> benchLayoutHeight) || x != 'x' ||
+		   benchLayoutWidth < 2 || benchLayoutHeight < 2) {
+			throw std::runtime_error("Expected a grid size like 4000x4000, not " + s);
+		}
+	}
+
+	/// Width in bits of the per-edge arrays (8, 16 or 32), or 0 to pick
+	/// the narrowest one that fits the instance's capacities
+	unsigned edgeBits = 0;
+
+	void setEdgeBits(const std::string &s)
+	{
+		if(s.empty() || s == "auto") {
+			edgeBits = 0;
+		}
+		else if(s == "8" || s == "16" || s == "32") {
+			edgeBits = std::stoul(s);
+		}
+		else {
+			throw std::runtime_error("Unknown edge width " + s + ". Options are 'auto', '8', '16', '32'.");
+		}
+	}
 	
+	/// One configuration raced in portfolio mode
+	struct PortfolioEntry {
+		std::string name; ///< as given on the command line
+		CostFunction costFunction;
+		bool useNetDecomposition;
+		bool useNetOrdering;
+	};
+
+	/// Configurations to race against each other, if any
+	std::vector<PortfolioEntry> portfolio;
+
+	/// How far, relatively, a configuration's best total overflow (or
+	/// wirelength, once the leader has no overflow) may trail the leader's
+	/// before it is cut off in portfolio mode
+	double portfolioCutoff = 0.1;
+
+	/// Parse a comma separated list of configurations COST[/D[/N]], where
+	/// COST is a cost function and D and N are 0 or 1 for net decomposition
+	/// and ordering, defaulting to -d and -n
+	void setPortfolio(const std::string &s)
+	{
+		portfolio.clear();
+
+		std::istringstream list(s);
+		std::string item;
+		while(std::getline(list, item, ',')) {
+			std::istringstream parts(item);
+			std::string cost, decomp, order, rest;
+			std::getline(parts, cost, '/');
+			std::getline(parts, decomp, '/');
+			std::getline(parts, order, '/');
+			if(cost.empty() || std::getline(parts, rest)) {
+				throw std::runtime_error("Expected a portfolio entry like nc/1/0, not " + item);
+			}
+
+			portfolio.push_back({item, parseCostFunction(cost),
+			                     parseSwitch(item, decomp, useNetDecomposition),
+			                     parseSwitch(item, order, useNetOrdering)});
+		}
+
+		if(portfolio.empty()) {
+			throw std::runtime_error("Expected at least one portfolio entry");
+		}
+	}
+
+	/// Parse "0" or "1" in the portfolio entry `item`, or use def if s is empty
+	static bool parseSwitch(const std::string &item, const std::string &s, bool def)
+	{
+		if(s.empty()) return def;
+		if(s != "0" && s != "1") {
+			throw std::runtime_error("Expected 0 or 1 for decomposition and ordering in portfolio entry " + item);
+		}
+		return s == "1";
+	}
+
 	void setCostFunction(const std::string &s)
+	{
+		costFunction = parseCostFunction(s);
+	}
+
+	static CostFunction parseCostFunction(const std::string &s)
 	{
 		if(s.empty() || s == "standard")
 		{
-			costFunction = Standard;
+			return Standard;
 		}
 		else if(s == "nc")
 		{
-			costFunction = NC;
+			return NC;
+		}
+		else if(s == "pathfinder")
+		{
+			return PathFinder;
 		}
 		else
 		{
-			throw std::runtime_error("Unknwon cost function " + s + ". Options are 'standard', 'nc'.");
+			throw std::runtime_error("Unknwon cost function " + s + ". Options are 'standard', 'nc', 'pathfinder'.");
 		}
 	}
 };
@@ -4,6 +4,7 @@
 #include <sstream>
 #include <cassert>
 #include <iostream>
+#include <limits>
 
 static std::map<std::string, Reader::TokenType> keywords = {
 	{"grid", Reader::KWGrid},
@@ -176,10 +177,12 @@ RoutingInst Reader::readRoutingInst()
 				}
 
 				int nBlockages = intValue;
+				const GridGeometry grid = result.geometry();
 
 				for(int i = 0; i < nBlockages; ++i) {
 					Point p1 = readPoint();
 					Point p2 = readPoint();
+					if(!grid.isUnitEdge(p1, p2)) fail("Blockage is not an edge of the grid.");
 					expect(TInteger);
 					int capacity = intValue;
 					result.setEdgeCap(p1, p2, capacity);
@@ -192,10 +195,111 @@ RoutingInst Reader::readRoutingInst()
 		readNextToken();
 	}
 
-	Point outermost = {result.gx - 1, result.gy - 1};
-	auto outermostV = Edge::vertical(outermost);
-	auto outermostH = Edge::horizontal(outermost);
-	result.edgeCap(outermostV.p1, outermostV.p2); // initialize edge capacities
-	result.edgeCap(outermostH.p1, outermostH.p2); 
+	result.edgeCaps.finalize();
 	return result;
-}
\ No newline at end of file
+}
+
+namespace {
+
+/// Parser for one line of a routing solution, failing with its line number
+struct SolutionLine {
+	const std::string &text;
+	int lineNum;
+	size_t pos;
+
+	SolutionLine(const std::string &text, int lineNum)
+	: text(text)
+	, lineNum(lineNum)
+	, pos(0)
+	{ }
+
+	void fail(const std::string &msg) const
+	{
+		std::stringstream s;
+		s << "Line " << lineNum << ": " << msg;
+		throw ParseError(s.str());
+	}
+
+	void expect(char c)
+	{
+		if(pos >= text.size() || text[pos] != c) {
+			fail(std::string("Expected '") + c + "' in '" + text + "'.");
+		}
+		++pos;
+	}
+
+	int readInt()
+	{
+		if(pos >= text.size() || !std::isdigit(text[pos])) {
+			fail("Expected a nonnegative integer in '" + text + "'.");
+		}
+		long long value = 0;
+		while(pos < text.size() && std::isdigit(text[pos])) {
+			value = value * 10 + (text[pos++] - '0');
+			if(value > std::numeric_limits<int>::max()) fail("Integer out of range in '" + text + "'.");
+		}
+		return int(value);
+	}
+
+	Point readPoint()
+	{
+		Point p;
+		expect('(');
+		p.x = readInt();
+		expect(',');
+		p.y = readInt();
+		expect(')');
+		return p;
+	}
+};
+
+} // end anonymous namespace
+
+std::vector<NetEdges> readSolution(std::istream &in)
+{
+	std::vector<NetEdges> result;
+	bool inNet = false;
+	std::string line;
+
+	for(int lineNum = 1; std::getline(in, line); ++lineNum) {
+		// ignore surrounding whitespace, including a '\r' from Windows line ends
+		const auto first = line.find_first_not_of(" \t\r");
+		if(first == std::string::npos) continue;
+		line = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+
+		SolutionLine parser(line, lineNum);
+
+		if(line[0] == 'n') {
+			if(inNet) parser.fail("Net " + line + " starts before the previous one ended with '!'.");
+			parser.expect('n');
+			result.push_back(NetEdges{parser.readInt(), {}});
+			inNet = true;
+		}
+		else if(line == "!") {
+			if(!inNet) parser.fail("'!' outside of a net.");
+			inNet = false;
+		}
+		else {
+			if(!inNet) parser.fail("Segment outside of a net: '" + line + "'.");
+			Point p1 = parser.readPoint();
+			parser.expect('-');
+			Point p2 = parser.readPoint();
+			if(parser.pos != line.size()) parser.fail("Trailing characters in '" + line + "'.");
+			if(p1.x != p2.x && p1.y != p2.y) parser.fail("Segment is neither horizontal nor vertical: '" + line + "'.");
+
+			// split into unit edges from the lower-left end
+			if(p2.x < p1.x || p2.y < p1.y) std::swap(p1, p2);
+			const bool vertical = p1.x == p2.x;
+			for(Point p = p1; p != p2; ) {
+				Edge e = vertical ? Edge::vertical(p) : Edge::horizontal(p);
+				result.back().edges.push_back(e);
+				p = e.p2;
+			}
+		}
+	}
+
+	if(inNet) {
+		throw ParseError("Net n" + std::to_string(result.back().id) + " isn't ended by '!' before the end of the file.");
+	}
+	return result;
+}
@@ -60,5 +60,17 @@ inline RoutingInst readRoutingInst(std::istream &in)
 	return Reader(in).readRoutingInst();
 }
 
+/// The edges one net uses in a routing solution
+struct NetEdges {
+	int id;
+	std::vector<Edge> edges; ///< unit edges, each with p1 at its lower-left end
+};
+
+/// Read a routing solution in the format Writer writes: for each net a line
+/// `nN`, one `(x1,y1)-(x2,y2)` line per horizontal or vertical segment, and
+/// a line `!`. Segments longer than one unit are split into unit edges.
+/// Throws ParseError, with the line number, on malformed input.
+std::vector<NetEdges> readSolution(std::istream &in);
+
 
 #endif // READER_HPP_NJ1QT0
\ No newline at end of file
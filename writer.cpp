@@ -1,6 +1,9 @@
 
 
 #include "writer.hpp"
+#include <algorithm>
+#include <thread>
+#include "IteratorUtils.hpp"
 
 
 void Writer::write(const Point &p)
@@ -32,4 +35,134 @@ void Writer::writeRouting()
 	for(const auto &net : routing.nets) {
 		write(net);
 	}
-}
\ No newline at end of file
+}
+
+namespace {
+
+void appendInt(std::string &text, int value)
+{
+	char digits[12];
+	char *p = digits + sizeof(digits);
+	unsigned v = value < 0 ? 0u - unsigned(value) : unsigned(value);
+	do {
+		*--p = char('0' + v % 10);
+		v /= 10;
+	} while(v != 0);
+	if(value < 0) *--p = '-';
+	text.append(p, digits + sizeof(digits));
+}
+
+void appendSegment(std::string &text, const Point &p1, const Point &p2)
+{
+	text += '(';
+	appendInt(text, p1.x);
+	text += ',';
+	appendInt(text, p1.y);
+	text += ")-(";
+	appendInt(text, p2.x);
+	text += ',';
+	appendInt(text, p2.y);
+	text += ")\n";
+}
+
+void appendNetName(std::string &text, const Net &n)
+{
+	text += 'n';
+	appendInt(text, n.id);
+	text += '\n';
+}
+
+} // end anonymous namespace
+
+void FastWriter::format(std::string &text, const Net &n) const
+{
+	appendNetName(text, n);
+	for(const auto &segment : n.nroute) {
+		for(int edge : segment.edges) {
+			const Edge e = grid.edge(edge);
+			appendSegment(text, e.p1, e.p2);
+		}
+	}
+	text += "!\n";
+}
+
+void FastWriter::formatMerged(std::string &text, const Net &n) const
+{
+	// Distinct edges by lower-left end: horizontal ones by row then x,
+	// vertical ones by column then y, so runs along a line are adjacent
+	std::vector<Point> horizontal, vertical;
+	for(const auto &segment : n.nroute) {
+		for(int edge : segment.edges) {
+			const Edge e = grid.edge(edge);
+			if(e.p1.y == e.p2.y) {
+				horizontal.push_back(Point{e.p1.y, e.p1.x});
+			}
+			else {
+				vertical.push_back(e.p1);
+			}
+		}
+	}
+
+	auto byLine = [](const Point &a, const Point &b) { return a.x < b.x || (a.x == b.x && a.y < b.y); };
+
+	appendNetName(text, n);
+	for(int pass = 0; pass < 2; ++pass) {
+		auto &starts = pass == 0 ? horizontal : vertical;
+		std::sort(starts.begin(), starts.end(), byLine);
+		starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+		// Each start is (line, position along it)
+		for(size_t i = 0; i < starts.size(); ) {
+			size_t j = i + 1;
+			while(j < starts.size() && starts[j].x == starts[i].x && starts[j].y == starts[j - 1].y + 1) ++j;
+
+			const int line = starts[i].x, from = starts[i].y, to = starts[j - 1].y + 1;
+			if(pass == 0) {
+				appendSegment(text, Point{from, line}, Point{to, line});
+			}
+			else {
+				appendSegment(text, Point{line, from}, Point{line, to});
+			}
+			i = j;
+		}
+	}
+	text += "!\n";
+}
+
+void FastWriter::writeRouting()
+{
+	writeNets(routing.nets);
+}
+
+void FastWriter::writeNets(const std::vector<Net> &nets)
+{
+	const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+	const size_t chunksPerBatch = 4 * threads;
+	std::vector<std::string> texts(chunksPerBatch);
+
+	for(size_t batch = 0; batch < nets.size(); batch += chunksPerBatch * netsPerChunk) {
+		const size_t batchEnd = std::min(nets.size(), batch + chunksPerBatch * netsPerChunk);
+		const size_t chunks = (batchEnd - batch + netsPerChunk - 1) / netsPerChunk;
+
+		std::vector<size_t> chunkIndices(chunks);
+		for(size_t c = 0; c < chunks; ++c) chunkIndices[c] = c;
+
+		parallelForEach(chunkIndices.begin(), chunkIndices.end(), [&](size_t c) {
+			std::string &text = texts[c];
+			text.clear();
+			const size_t begin = batch + c * netsPerChunk, end = std::min(batchEnd, begin + netsPerChunk);
+			for(size_t i = begin; i < end; ++i) {
+				if(mergeSegments) {
+					formatMerged(text, nets[i]);
+				}
+				else {
+					format(text, nets[i]);
+				}
+			}
+		});
+
+		for(size_t c = 0; c < chunks; ++c) {
+			out.write(texts[c].data(), texts[c].size());
+		}
+	}
+}